@@ -0,0 +1 @@
+log/async_log.hpp
\ No newline at end of file
@@ -12,9 +12,17 @@
 #define _tools_big_hpp_INCLUDED_
 
 #include "big_types.hpp"
+#include "big_header.hpp"
+#include "big_compression.hpp"
 #include "big_exception.hpp"
 #include "big_read.hpp"
+#include "big_any_read.hpp"
 #include "big_write.hpp"
 #include "big_undef_conversion.hpp"
+#include "big_mapped_read.hpp"
+#include "big_tar.hpp"
+#include "big_sequence.hpp"
+#include "big_async_read.hpp"
+#include "big_async_write.hpp"
 
 #endif
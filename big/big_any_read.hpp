@@ -0,0 +1,274 @@
+/// \file tools/big_any_read.hpp
+/// \author Benjamin Buch (benni.buch@gmail.com)
+/// \brief Reading big files with a value type known only at runtime
+///
+/// Copyright (c) 2015 Benjamin Buch (benni dot buch at gmail dot com)
+///
+/// Distributed under the Boost Software License, Version 1.0. (See accompanying
+/// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+///
+#ifndef _tools_big_any_read_hpp_INCLUDED_
+#define _tools_big_any_read_hpp_INCLUDED_
+
+#include "big_types.hpp"
+#include "big_header.hpp"
+#include "big_exception.hpp"
+#include "big_read.hpp"
+
+#include <boost/variant.hpp>
+
+#include <string>
+#include <memory>
+#include <limits>
+#include <fstream>
+#include <cstdint>
+#include <utility>
+#include <type_traits>
+
+namespace tools { namespace big {
+
+
+	/// \brief A bitmap with any value type a big file can contain
+	///
+	/// The type in a big file carries no sign and only the size of the
+	/// integers, so integer files are loaded with unsigned fixed width types.
+	using any_bitmap = boost::variant<
+		tools::bitmap< std::uint8_t >,
+		tools::bitmap< std::uint16_t >,
+		tools::bitmap< std::uint32_t >,
+		tools::bitmap< std::uint64_t >,
+		float_type,
+		double_type
+	>;
+
+
+	/// \brief Loads a big file of any type by a given filename
+	/// \throw tools::big::big_error
+	any_bitmap read_any(std::string const& filename);
+
+	/// \brief Loads a big file of any type from a std::istream
+	/// \throw tools::big::big_error
+	any_bitmap read_any(std::istream& is);
+
+	/// \brief Loads a big file of any type and calls boost::apply_visitor with it
+	/// \throw tools::big::big_error
+	template < typename Visitor >
+	decltype(auto) read_visit(std::string const& filename, Visitor&& visitor);
+
+	/// \brief Loads a big file of any type into a bitmap of another type
+	///
+	/// The values are converted row by row while reading. Conversions from
+	/// floating point to integer saturate and map NaN to 0, narrowing integer
+	/// conversions saturate.
+	///
+	/// \throw tools::big::big_error
+	template < typename BitmapType >
+	void read_convert(BitmapType& bitmap, std::string const& filename);
+
+	/// \brief Loads a big file of any type from a std::istream into a bitmap of another type
+	/// \throw tools::big::big_error
+	template < typename BitmapType >
+	void read_convert(BitmapType& bitmap, std::istream& is);
+
+
+	//=============================================================================
+	// Implementation
+	//=============================================================================
+
+	namespace impl{ namespace big{
+
+
+		/// \brief Calls f with a null pointer to the value type of a file type
+		/// \throw tools::big::big_error
+		template < typename F >
+		decltype(auto) dispatch_type(std::uint16_t file_type, F&& f){
+			switch(file_type){
+				case type< std::uint8_t >::value:  return f(static_cast< std::uint8_t* >(nullptr));
+				case type< std::uint16_t >::value: return f(static_cast< std::uint16_t* >(nullptr));
+				case type< std::uint32_t >::value: return f(static_cast< std::uint32_t* >(nullptr));
+				case type< std::uint64_t >::value: return f(static_cast< std::uint64_t* >(nullptr));
+				case type< float >::value:         return f(static_cast< float* >(nullptr));
+				case type< double >::value:        return f(static_cast< double* >(nullptr));
+			}
+
+			throw big_error("Unsupported type in file");
+		}
+
+
+		/// \brief Convert between floating point types
+		template < typename Target, typename Source >
+		Target convert_value(Source value, std::true_type, std::true_type){
+			return static_cast< Target >(value);
+		}
+
+		/// \brief Convert from floating point to integer
+		template < typename Target, typename Source >
+		Target convert_value(Source value, std::false_type, std::true_type){
+			if(value != value) return Target(0);
+			if(value <= static_cast< Source >(std::numeric_limits< Target >::lowest())){
+				return std::numeric_limits< Target >::lowest();
+			}
+			if(value >= static_cast< Source >(std::numeric_limits< Target >::max())){
+				return std::numeric_limits< Target >::max();
+			}
+			return static_cast< Target >(value);
+		}
+
+		/// \brief Convert from unsigned integer to floating point
+		template < typename Target, typename Source >
+		Target convert_value(Source value, std::true_type, std::false_type){
+			return static_cast< Target >(value);
+		}
+
+		/// \brief Convert from unsigned integer to integer
+		template < typename Target, typename Source >
+		Target convert_value(Source value, std::false_type, std::false_type){
+			static_assert(std::is_unsigned< Source >::value, "Integer files are unsigned");
+
+			using common = typename std::common_type< Source, std::uintmax_t >::type;
+			if(static_cast< common >(value) > static_cast< common >(std::numeric_limits< Target >::max())){
+				return std::numeric_limits< Target >::max();
+			}
+			return static_cast< Target >(value);
+		}
+
+		/// \brief Convert a value of a file to another type
+		///
+		/// Source undef values are NaN or saturated already.
+		template < typename Target, typename Source >
+		Target convert_value(Source value){
+			return convert_value< Target >(
+				value,
+				std::is_floating_point< Target >(),
+				std::is_floating_point< Source >()
+			);
+		}
+
+
+		/// \brief Read a payload of the target type
+		template < typename Source, typename Target >
+		void read_converted_frame(bitmap_view< Target > view, std::istream& is, header const& header, std::true_type){
+			read_payload(view, is, header);
+		}
+
+		/// \brief Read a payload of type Source and convert it while reading
+		template < typename Source, typename Target >
+		void read_converted_frame(bitmap_view< Target > view, std::istream& is, header const& header, std::false_type){
+			if(header.placeholder & header_flags::compressed){
+				// blocks are decoded as a whole, convert behind
+				bitmap< Source > buffer(view.width(), view.height(), tools::uninitialized);
+				read_compressed_frame(bitmap_view< Source >(buffer), is, header);
+
+				for(std::size_t y = 0; y < view.height(); ++y){
+					auto const row = view.row(y);
+					for(std::size_t x = 0; x < view.width(); ++x){
+						row[x] = convert_value< Target >(buffer(x, y));
+					}
+				}
+
+				return;
+			}
+
+			auto const file_row_bytes = row_bytes< Source >(header);
+			std::unique_ptr< Source[] > buffer(new Source[view.width()]);
+
+			for(std::size_t y = 0; y < view.height(); ++y){
+				is.read(reinterpret_cast< std::ifstream::char_type* >(buffer.get()), view.width() * sizeof(Source));
+
+				// skip the padding behind the row
+				if(y + 1 < view.height()) is.ignore(file_row_bytes - view.width() * sizeof(Source));
+
+				auto const row = view.row(y);
+				for(std::size_t x = 0; x < view.width(); ++x){
+					row[x] = convert_value< Target >(undef_to_nan(buffer[x]));
+				}
+			}
+
+			if(!is.good()){
+				throw big_error("Can't read big content");
+			}
+		}
+
+		/// \brief Read a payload of type Source into a view of type Target
+		template < typename Source, typename Target >
+		void read_converted_frame(bitmap_view< Target > view, std::istream& is, header const& header){
+			read_converted_frame< Source >(view, is, header, std::is_same< Source, Target >());
+		}
+
+
+	} }
+
+
+	inline any_bitmap read_any(std::string const& filename){
+		std::ifstream is(filename.c_str(), std::ios_base::in | std::ios_base::binary);
+
+		if(!is.is_open()){
+			throw big_error("Can't open file: " + filename);
+		}
+
+		try{
+			return read_any(is);
+		}catch(big_error const& error){
+			throw big_error(std::string(error.what()) + ": " + filename);
+		}
+	}
+
+	inline any_bitmap read_any(std::istream& is){
+		header const header = read_header(is);
+
+		impl::big::check_single_bitmap(header);
+
+		return impl::big::dispatch_type(header.type, [&](auto* tag)->any_bitmap{
+			using value_type = std::remove_pointer_t< decltype(tag) >;
+
+			impl::big::check_type< value_type >(header);
+
+			bitmap< value_type > result(header.width, header.height, tools::uninitialized);
+			impl::big::read_payload(bitmap_view< value_type >(result), is, header);
+			return result;
+		});
+	}
+
+	template < typename Visitor >
+	decltype(auto) read_visit(std::string const& filename, Visitor&& visitor){
+		auto bitmap = read_any(filename);
+		return boost::apply_visitor(std::forward< Visitor >(visitor), bitmap);
+	}
+
+	template < typename BitmapType >
+	void read_convert(BitmapType& bitmap, std::string const& filename){
+		std::ifstream is(filename.c_str(), std::ios_base::in | std::ios_base::binary);
+
+		if(!is.is_open()){
+			throw big_error("Can't open file: " + filename);
+		}
+
+		try{
+			read_convert(bitmap, is);
+		}catch(big_error const& error){
+			throw big_error(std::string(error.what()) + ": " + filename);
+		}
+	}
+
+	template < typename BitmapType >
+	void read_convert(BitmapType& bitmap, std::istream& is){
+		using value_type = typename BitmapType::value_type;
+
+		header const header = read_header(is);
+
+		impl::big::check_single_bitmap(header);
+
+		impl::big::dispatch_type(header.type, [&](auto* tag){
+			using source_type = std::remove_pointer_t< decltype(tag) >;
+
+			impl::big::check_type< source_type >(header);
+
+			bitmap.resize(header.width, header.height, tools::uninitialized);
+			impl::big::read_converted_frame< source_type >(bitmap_view< value_type >(bitmap), is, header);
+		});
+	}
+
+
+} }
+
+#endif
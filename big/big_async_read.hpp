@@ -0,0 +1,207 @@
+/// \file tools/big_async_read.hpp
+/// \author Benjamin Buch (benni.buch@gmail.com)
+/// \brief class template tools::big::async_reader
+///
+/// Copyright (c) 2015 Benjamin Buch (benni dot buch at gmail dot com)
+///
+/// Distributed under the Boost Software License, Version 1.0. (See accompanying
+/// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+///
+#ifndef _tools_big_async_read_hpp_INCLUDED_
+#define _tools_big_async_read_hpp_INCLUDED_
+
+#include "big_read.hpp"
+#include "big_sequence.hpp"
+
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+
+namespace tools { namespace big {
+
+
+	/// \brief Reads big files on a background thread ahead of their use
+	///
+	/// Up to prefetch frames are loaded in advance and handed out in order. The
+	/// caller can process one frame while the next ones are read from disk.
+	///
+	/// An error while loading a frame is thrown by the call of next() that
+	/// would have returned the frame, all following calls return false.
+	template < typename ValueType >
+	class async_reader{
+	public:
+		/// \brief Type of the data
+		using value_type = ValueType;
+
+
+		/// \brief Reads the files one after another
+		explicit async_reader(std::vector< std::string > filenames, std::size_t prefetch = 4);
+
+		/// \brief Reads all frames of a multi frame big file
+		explicit async_reader(sequence_reader< value_type > reader, std::size_t prefetch = 4);
+
+		async_reader(async_reader const&) = delete;
+		async_reader& operator=(async_reader const&) = delete;
+
+		/// \brief Stops reading and waits for the background thread
+		~async_reader();
+
+
+		/// \brief Get the count of all frames
+		std::size_t frame_count()const{
+			return frame_count_;
+		}
+
+		/// \brief Waits for the next frame
+		///
+		/// \return false if all frames have been handed out
+		/// \throw tools::big::big_error
+		bool next(bitmap< value_type >& bitmap);
+
+
+	private:
+		/// \brief Starts the background thread
+		void start(std::function< void(std::size_t, bitmap< value_type >&) > load);
+
+		/// \brief Loop of the background thread
+		void run(std::function< void(std::size_t, bitmap< value_type >&) > const& load);
+
+		std::size_t const frame_count_;
+		std::size_t const prefetch_;
+
+		std::mutex mutex_;
+		std::condition_variable not_empty_;
+		std::condition_variable not_full_;
+
+		/// \brief Loaded frames that have not been handed out yet
+		std::deque< bitmap< value_type > > queue_;
+
+		/// \brief Error of the frame behind the last one in queue_
+		std::exception_ptr error_;
+
+		/// \brief true if no further frame will be loaded
+		bool finished_ = false;
+
+		/// \brief Set by the destructor
+		bool stop_ = false;
+
+		std::thread thread_;
+	};
+
+
+	//=============================================================================
+	// Implementation
+	//=============================================================================
+
+	template < typename ValueType >
+	async_reader< ValueType >::async_reader(std::vector< std::string > filenames, std::size_t prefetch):
+		frame_count_(filenames.size()),
+		prefetch_(prefetch > 0 ? prefetch : 1)
+	{
+		start([filenames = std::move(filenames)](std::size_t i, bitmap< value_type >& bitmap){
+			read(bitmap, filenames[i]);
+		});
+	}
+
+	template < typename ValueType >
+	async_reader< ValueType >::async_reader(sequence_reader< value_type > reader, std::size_t prefetch):
+		frame_count_(reader.frame_count()),
+		prefetch_(prefetch > 0 ? prefetch : 1)
+	{
+		auto shared_reader = std::make_shared< sequence_reader< value_type > >(std::move(reader));
+		start([shared_reader](std::size_t i, bitmap< value_type >& bitmap){
+			bitmap.resize(shared_reader->size(), tools::uninitialized);
+			shared_reader->read_frame(i, bitmap_view< value_type >(bitmap));
+		});
+	}
+
+	template < typename ValueType >
+	async_reader< ValueType >::~async_reader(){
+		{
+			std::lock_guard< std::mutex > lock(mutex_);
+			stop_ = true;
+		}
+		not_full_.notify_one();
+
+		thread_.join();
+	}
+
+	template < typename ValueType >
+	bool async_reader< ValueType >::next(bitmap< value_type >& bitmap){
+		std::unique_lock< std::mutex > lock(mutex_);
+		not_empty_.wait(lock, [this]{ return !queue_.empty() || finished_; });
+
+		if(queue_.empty()){
+			if(error_){
+				auto error = error_;
+				error_ = nullptr;
+				std::rethrow_exception(error);
+			}
+
+			return false;
+		}
+
+		bitmap = std::move(queue_.front());
+		queue_.pop_front();
+
+		lock.unlock();
+		not_full_.notify_one();
+
+		return true;
+	}
+
+	template < typename ValueType >
+	void async_reader< ValueType >::start(std::function< void(std::size_t, bitmap< value_type >&) > load){
+		thread_ = std::thread([this, load = std::move(load)]{
+			run(load);
+		});
+	}
+
+	template < typename ValueType >
+	void async_reader< ValueType >::run(std::function< void(std::size_t, bitmap< value_type >&) > const& load){
+		for(std::size_t i = 0; i < frame_count_; ++i){
+			{
+				std::unique_lock< std::mutex > lock(mutex_);
+				not_full_.wait(lock, [this]{ return queue_.size() < prefetch_ || stop_; });
+				if(stop_) return;
+			}
+
+			// the file is read without lock, so next() can hand out frames meanwhile
+			bitmap< value_type > bitmap;
+			std::exception_ptr error;
+			try{
+				load(i, bitmap);
+			}catch(...){
+				error = std::current_exception();
+			}
+
+			{
+				std::lock_guard< std::mutex > lock(mutex_);
+				if(error){
+					error_ = error;
+					finished_ = true;
+				}else{
+					queue_.push_back(std::move(bitmap));
+					finished_ = i + 1 == frame_count_;
+				}
+			}
+			not_empty_.notify_one();
+
+			if(error) return;
+		}
+
+		std::lock_guard< std::mutex > lock(mutex_);
+		finished_ = true;
+		not_empty_.notify_one();
+	}
+
+
+} }
+
+#endif
@@ -0,0 +1,272 @@
+/// \file tools/big_async_write.hpp
+/// \author Benjamin Buch (benni.buch@gmail.com)
+/// \brief class template tools::big::async_writer
+///
+/// Copyright (c) 2015 Benjamin Buch (benni dot buch at gmail dot com)
+///
+/// Distributed under the Boost Software License, Version 1.0. (See accompanying
+/// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+///
+#ifndef _tools_big_async_write_hpp_INCLUDED_
+#define _tools_big_async_write_hpp_INCLUDED_
+
+#include "big_write.hpp"
+#include "big_undef_conversion.hpp"
+
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <future>
+#include <fstream>
+#include <exception>
+#include <condition_variable>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define TOOLS_BIG_ASYNC_WRITE_POSIX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace tools { namespace big {
+
+
+	/// \brief Writes big files on a background thread
+	///
+	/// write() moves the bitmap into a bounded queue and returns immediately
+	/// unless the queue is full. The worker converts NaN to undef in the
+	/// memory of the moved bitmap, so no converted copy is allocated.
+	///
+	/// With a sync_batch > 0 the written files are synchronized to disk by
+	/// fsync after sync_batch files or when the queue runs empty. The future of
+	/// a file is ready after its data is on disk in this case.
+	template < typename ValueType, typename Layout = dense_layout >
+	class async_writer{
+	public:
+		/// \brief Type of the data
+		using value_type = ValueType;
+
+		/// \brief Type of the accepted bitmaps
+		using bitmap_type = bitmap< value_type, Layout >;
+
+
+		/// \brief Starts the worker thread
+		///
+		/// \param queue_size Maximal count of bitmaps waiting for the worker
+		/// \param sync_batch Count of files per fsync, 0 for no fsync
+		explicit async_writer(std::size_t queue_size = 8, std::size_t sync_batch = 0);
+
+		async_writer(async_writer const&) = delete;
+		async_writer& operator=(async_writer const&) = delete;
+
+		/// \brief Writes all queued bitmaps and waits for the worker thread
+		~async_writer();
+
+
+		/// \brief Queues a bitmap for writing, blocks while the queue is full
+		///
+		/// The future throws tools::big::big_error if the file can't be written.
+		std::future< void > write(bitmap_type&& bitmap, std::string filename);
+
+		/// \brief Waits until all queued bitmaps are written (and synchronized)
+		void flush();
+
+
+	private:
+		/// \brief A bitmap waiting for the worker
+		struct job{
+			bitmap_type bitmap;
+			std::string filename;
+			std::promise< void > promise;
+		};
+
+		/// \brief A written file waiting for fsync
+		struct written{
+			std::string filename;
+			std::promise< void > promise;
+		};
+
+		/// \brief Loop of the worker thread
+		void run();
+
+		/// \brief Synchronize all files in pending and fulfill their promises
+		static void sync(std::vector< written >& pending);
+
+		std::size_t const queue_size_;
+		std::size_t const sync_batch_;
+
+		std::mutex mutex_;
+		std::condition_variable not_empty_;
+		std::condition_variable not_full_;
+		std::condition_variable idle_;
+
+		std::deque< job > queue_;
+
+		/// \brief true while the worker processes a job outside of the queue
+		bool busy_ = false;
+
+		/// \brief Set by the destructor
+		bool stop_ = false;
+
+		std::thread thread_;
+	};
+
+
+	//=============================================================================
+	// Implementation
+	//=============================================================================
+
+	namespace impl{ namespace big{
+
+
+		/// \brief Write data and metadata of a file to disk
+		/// \throw tools::big::big_error
+		inline void sync_file(std::string const& filename){
+#ifdef TOOLS_BIG_ASYNC_WRITE_POSIX
+			int const fd = ::open(filename.c_str(), O_WRONLY);
+			if(fd < 0){
+				throw big_error("Can't open file for sync: " + filename);
+			}
+
+			int const result = ::fsync(fd);
+			::close(fd);
+
+			if(result != 0){
+				throw big_error("Can't sync file: " + filename);
+			}
+#else
+			// no portable fsync, the data was handed to the operating system by close
+			(void)filename;
+#endif
+		}
+
+
+	} }
+
+
+	template < typename ValueType, typename Layout >
+	async_writer< ValueType, Layout >::async_writer(std::size_t queue_size, std::size_t sync_batch):
+		queue_size_(queue_size > 0 ? queue_size : 1),
+		sync_batch_(sync_batch),
+		thread_([this]{ run(); })
+		{}
+
+	template < typename ValueType, typename Layout >
+	async_writer< ValueType, Layout >::~async_writer(){
+		{
+			std::lock_guard< std::mutex > lock(mutex_);
+			stop_ = true;
+		}
+		not_empty_.notify_one();
+
+		thread_.join();
+	}
+
+	template < typename ValueType, typename Layout >
+	std::future< void > async_writer< ValueType, Layout >::write(bitmap_type&& bitmap, std::string filename){
+		std::promise< void > promise;
+		auto future = promise.get_future();
+
+		{
+			std::unique_lock< std::mutex > lock(mutex_);
+			not_full_.wait(lock, [this]{ return queue_.size() < queue_size_; });
+			queue_.push_back(job{std::move(bitmap), std::move(filename), std::move(promise)});
+		}
+		not_empty_.notify_one();
+
+		return future;
+	}
+
+	template < typename ValueType, typename Layout >
+	void async_writer< ValueType, Layout >::flush(){
+		std::unique_lock< std::mutex > lock(mutex_);
+		idle_.wait(lock, [this]{ return queue_.empty() && !busy_; });
+	}
+
+	template < typename ValueType, typename Layout >
+	void async_writer< ValueType, Layout >::run(){
+		std::vector< written > pending;
+
+		for(;;){
+			std::unique_lock< std::mutex > lock(mutex_);
+
+			if(queue_.empty()){
+				// nothing to do, synchronize the files of the last batch
+				if(!pending.empty()){
+					lock.unlock();
+					sync(pending);
+					lock.lock();
+					continue;
+				}
+
+				busy_ = false;
+				idle_.notify_all();
+
+				not_empty_.wait(lock, [this]{ return !queue_.empty() || stop_; });
+				if(queue_.empty()) return;
+			}
+
+			job current = std::move(queue_.front());
+			queue_.pop_front();
+			busy_ = true;
+
+			lock.unlock();
+			not_full_.notify_one();
+
+			try{
+				std::ofstream os(current.filename.c_str(), std::ios_base::out | std::ios_base::binary);
+
+				if(!os.is_open()){
+					throw big_error("Can't open file: " + current.filename);
+				}
+
+				try{
+					bitmap_view< value_type > view(current.bitmap);
+					convert_nan_to_undef_in_place(view);
+
+					write_header(make_header< value_type >(view.width(), view.height()), os);
+					impl::big::write_raw_frame(view, os);
+
+					os.close();
+					if(os.fail()){
+						throw big_error("Can't write big content");
+					}
+				}catch(big_error const& error){
+					throw big_error(std::string(error.what()) + ": " + current.filename);
+				}
+
+				if(sync_batch_ == 0){
+					current.promise.set_value();
+				}else{
+					pending.push_back(written{std::move(current.filename), std::move(current.promise)});
+					if(pending.size() >= sync_batch_){
+						sync(pending);
+					}
+				}
+			}catch(...){
+				current.promise.set_exception(std::current_exception());
+			}
+		}
+	}
+
+	template < typename ValueType, typename Layout >
+	void async_writer< ValueType, Layout >::sync(std::vector< written >& pending){
+		for(auto& file: pending){
+			try{
+				impl::big::sync_file(file.filename);
+				file.promise.set_value();
+			}catch(...){
+				file.promise.set_exception(std::current_exception());
+			}
+		}
+
+		pending.clear();
+	}
+
+
+} }
+
+#undef TOOLS_BIG_ASYNC_WRITE_POSIX
+
+#endif
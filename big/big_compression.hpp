@@ -0,0 +1,675 @@
+/// \file tools/big_compression.hpp
+/// \author Benjamin Buch (benni.buch@gmail.com)
+/// \brief Compressed payloads of big files
+///
+/// Copyright (c) 2015 Benjamin Buch (benni dot buch at gmail dot com)
+///
+/// Distributed under the Boost Software License, Version 1.0. (See accompanying
+/// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+///
+#ifndef _tools_big_compression_hpp_INCLUDED_
+#define _tools_big_compression_hpp_INCLUDED_
+
+#include "big_header.hpp"
+#include "big_exception.hpp"
+#include "big_undef_conversion.hpp"
+#include "bitmap_view.hpp"
+
+#include <atomic>
+#include <future>
+#include <thread>
+#include <vector>
+#include <limits>
+#include <cstring>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <algorithm>
+#include <type_traits>
+
+namespace tools { namespace big {
+
+
+	/// \brief Codecs for compressed payloads
+	enum class codec: std::uint8_t{
+		/// \brief LZ4 block format
+		lz4 = 1
+	};
+
+	/// \brief Prefilters that are applied before the codec
+	enum class filter: std::uint8_t{
+		/// \brief The values are compressed as they are
+		none = 0,
+
+		/// \brief The bytes of the values are grouped by significance
+		shuffle = 1,
+
+		/// \brief Every value is replaced by the difference to its left neighbor, then shuffled
+		delta_shuffle = 2,
+
+		/// \brief default_filter< ValueType >() is used, never stored in a file
+		automatic = 255
+	};
+
+
+	/// \brief Parameters of a compressed payload
+	///
+	/// The payload is split into blocks of rows_per_block rows which are
+	/// filtered and compressed independently. Behind the header follows a
+	/// table with the compressed size of every block as 64 bit values, then
+	/// the blocks. A block with the size of its uncompressed data is stored
+	/// uncompressed.
+	struct compression{
+		/// \brief Codec of the blocks
+		big::codec codec = big::codec::lz4;
+
+		/// \brief Prefilter applied before the codec
+		big::filter filter = big::filter::automatic;
+
+		/// \brief Rows per block, 0 for blocks of about 64 KiB
+		std::uint32_t rows_per_block = 0;
+	};
+
+
+	/// \brief Get the prefilter that works best for typical data of ValueType
+	///
+	/// Floating point values are shuffled, 16 bit values get delta and
+	/// shuffle, 8 bit values are not filtered.
+	template < typename ValueType >
+	constexpr big::filter default_filter(){
+		return std::is_floating_point< ValueType >::value ? big::filter::shuffle :
+			sizeof(ValueType) == 1 ? big::filter::none : big::filter::delta_shuffle;
+	}
+
+
+	//=============================================================================
+	// Implementation
+	//=============================================================================
+
+	namespace impl{ namespace big{ namespace lz4{
+
+
+		constexpr std::size_t min_match = 4;
+		constexpr std::size_t last_literals = 5;
+		constexpr std::size_t match_find_limit = 12;
+		constexpr std::size_t max_offset = 65535;
+		constexpr unsigned hash_log = 14;
+
+
+		/// \brief Get the maximal size of compressed data
+		inline std::size_t compress_bound(std::size_t size){
+			return size + size / 255 + 16;
+		}
+
+		inline std::uint32_t read32(unsigned char const* data){
+			std::uint32_t result;
+			std::memcpy(&result, data, sizeof(result));
+			return result;
+		}
+
+		inline std::uint32_t hash(std::uint32_t sequence){
+			return (sequence * 2654435761u) >> (32 - hash_log);
+		}
+
+		/// \brief Write a length of 15 or more in the LZ4 length encoding
+		inline unsigned char* write_length(unsigned char* out, std::size_t length){
+			for(; length >= 255; length -= 255){
+				*out++ = 255;
+			}
+			*out++ = static_cast< unsigned char >(length);
+			return out;
+		}
+
+		/// \brief Write a sequence of literals and an optional match
+		inline unsigned char* write_sequence(
+			unsigned char* out,
+			unsigned char const* literals, std::size_t literal_count,
+			std::size_t offset, std::size_t match_length
+		){
+			unsigned char* token = out++;
+
+			*token = static_cast< unsigned char >(std::min< std::size_t >(literal_count, 15) << 4);
+			if(literal_count >= 15){
+				out = write_length(out, literal_count - 15);
+			}
+
+			std::memcpy(out, literals, literal_count);
+			out += literal_count;
+
+			if(match_length == 0) return out;
+
+			*out++ = static_cast< unsigned char >(offset);
+			*out++ = static_cast< unsigned char >(offset >> 8);
+
+			match_length -= min_match;
+			*token |= static_cast< unsigned char >(std::min< std::size_t >(match_length, 15));
+			if(match_length >= 15){
+				out = write_length(out, match_length - 15);
+			}
+
+			return out;
+		}
+
+		/// \brief Compress in the LZ4 block format
+		///
+		/// out must have at least compress_bound(size) bytes.
+		///
+		/// \return Size of the compressed data
+		inline std::size_t compress(unsigned char const* in, std::size_t size, unsigned char* out){
+			unsigned char* const out_begin = out;
+			std::size_t anchor = 0;
+
+			if(size >= match_find_limit + 1){
+				std::vector< std::uint32_t > table(std::size_t(1) << hash_log, 0);
+
+				std::size_t const match_limit = size - last_literals;
+				std::size_t pos = 0;
+
+				while(pos + match_find_limit <= size){
+					auto const sequence = read32(in + pos);
+					auto& entry = table[hash(sequence)];
+					std::size_t const ref = entry;
+					entry = static_cast< std::uint32_t >(pos);
+
+					if(ref >= pos || pos - ref > max_offset || read32(in + ref) != sequence){
+						// skip faster through incompressible data
+						pos += 1 + ((pos - anchor) >> 6);
+						continue;
+					}
+
+					std::size_t length = min_match;
+					while(pos + length < match_limit && in[ref + length] == in[pos + length]){
+						++length;
+					}
+
+					out = write_sequence(out, in + anchor, pos - anchor, pos - ref, length);
+					pos += length;
+					anchor = pos;
+				}
+			}
+
+			out = write_sequence(out, in + anchor, size - anchor, 0, 0);
+			return static_cast< std::size_t >(out - out_begin);
+		}
+
+		/// \brief Read a length of 15 or more in the LZ4 length encoding
+		inline bool read_length(unsigned char const*& in, unsigned char const* in_end, std::size_t& length){
+			unsigned char byte;
+			do{
+				if(in == in_end) return false;
+				byte = *in++;
+				length += byte;
+			}while(byte == 255);
+			return true;
+		}
+
+		/// \brief Decompress data in the LZ4 block format
+		///
+		/// \throw tools::big::big_error if the data is corrupt or doesn't fill exactly size bytes
+		inline void decompress(unsigned char const* in, std::size_t in_size, unsigned char* out, std::size_t size){
+			unsigned char const* const in_end = in + in_size;
+			unsigned char* const out_begin = out;
+			unsigned char* const out_end = out + size;
+
+			for(;;){
+				if(in == in_end) throw big_error("Corrupt compressed block");
+
+				auto const token = *in++;
+
+				std::size_t literal_count = token >> 4;
+				if(literal_count == 15 && !read_length(in, in_end, literal_count)){
+					throw big_error("Corrupt compressed block");
+				}
+
+				if(
+					literal_count > static_cast< std::size_t >(in_end - in) ||
+					literal_count > static_cast< std::size_t >(out_end - out)
+				){
+					throw big_error("Corrupt compressed block");
+				}
+
+				std::memcpy(out, in, literal_count);
+				in += literal_count;
+				out += literal_count;
+
+				// the last sequence has no match
+				if(in == in_end) break;
+
+				if(in_end - in < 2) throw big_error("Corrupt compressed block");
+				std::size_t const offset = in[0] | (std::size_t(in[1]) << 8);
+				in += 2;
+
+				if(offset == 0 || offset > static_cast< std::size_t >(out - out_begin)){
+					throw big_error("Corrupt compressed block");
+				}
+
+				std::size_t length = token & 0x0F;
+				if(length == 15 && !read_length(in, in_end, length)){
+					throw big_error("Corrupt compressed block");
+				}
+				length += min_match;
+
+				if(length > static_cast< std::size_t >(out_end - out)){
+					throw big_error("Corrupt compressed block");
+				}
+
+				unsigned char const* match = out - offset;
+				if(offset >= length){
+					std::memcpy(out, match, length);
+					out += length;
+				}else{
+					// overlapping match repeats the last offset bytes
+					for(std::size_t i = 0; i < length; ++i){
+						*out++ = *match++;
+					}
+				}
+			}
+
+			if(out != out_end){
+				throw big_error("Corrupt compressed block");
+			}
+		}
+
+
+	} } }
+
+
+	namespace impl{ namespace big{
+
+
+		/// \brief Unsigned integer with a size of Bytes
+		template < std::size_t Bytes > struct unsigned_of_size{};
+		template <> struct unsigned_of_size< 1 >{ using type = std::uint8_t; };
+		template <> struct unsigned_of_size< 2 >{ using type = std::uint16_t; };
+		template <> struct unsigned_of_size< 4 >{ using type = std::uint32_t; };
+		template <> struct unsigned_of_size< 8 >{ using type = std::uint64_t; };
+
+		/// \brief true if delta can be computed on values with a size of Bytes
+		template < std::size_t Bytes >
+		struct has_delta: std::integral_constant< bool, Bytes == 1 || Bytes == 2 || Bytes == 4 || Bytes == 8 >{};
+
+
+		/// \brief Replace every value of each row by the difference to its left neighbor
+		template < std::size_t Bytes >
+		void delta_encode(unsigned char* data, std::size_t width, std::size_t height, std::true_type){
+			using value_type = typename unsigned_of_size< Bytes >::type;
+
+			for(std::size_t y = 0; y < height; ++y){
+				unsigned char* row = data + y * width * Bytes;
+
+				value_type previous = 0;
+				for(std::size_t x = 0; x < width; ++x){
+					value_type value;
+					std::memcpy(&value, row + x * Bytes, Bytes);
+					value_type const difference = static_cast< value_type >(value - previous);
+					std::memcpy(row + x * Bytes, &difference, Bytes);
+					previous = value;
+				}
+			}
+		}
+
+		/// \brief Inverse of delta_encode
+		template < std::size_t Bytes >
+		void delta_decode(unsigned char* data, std::size_t width, std::size_t height, std::true_type){
+			using value_type = typename unsigned_of_size< Bytes >::type;
+
+			for(std::size_t y = 0; y < height; ++y){
+				unsigned char* row = data + y * width * Bytes;
+
+				value_type previous = 0;
+				for(std::size_t x = 0; x < width; ++x){
+					value_type difference;
+					std::memcpy(&difference, row + x * Bytes, Bytes);
+					previous = static_cast< value_type >(previous + difference);
+					std::memcpy(row + x * Bytes, &previous, Bytes);
+				}
+			}
+		}
+
+		template < std::size_t Bytes >
+		void delta_encode(unsigned char*, std::size_t, std::size_t, std::false_type){
+			throw big_error("Delta filter is not supported for this value type");
+		}
+
+		template < std::size_t Bytes >
+		void delta_decode(unsigned char*, std::size_t, std::size_t, std::false_type){
+			throw big_error("Delta filter is not supported for this value type");
+		}
+
+
+		/// \brief Group byte i of all count values in plane i
+		inline void shuffle(unsigned char const* in, unsigned char* out, std::size_t count, std::size_t bytes){
+			for(std::size_t i = 0; i < count; ++i){
+				for(std::size_t b = 0; b < bytes; ++b){
+					out[b * count + i] = in[i * bytes + b];
+				}
+			}
+		}
+
+		/// \brief Inverse of shuffle
+		inline void unshuffle(unsigned char const* in, unsigned char* out, std::size_t count, std::size_t bytes){
+			for(std::size_t b = 0; b < bytes; ++b){
+				unsigned char const* plane = in + b * count;
+				for(std::size_t i = 0; i < count; ++i){
+					out[i * bytes + b] = plane[i];
+				}
+			}
+		}
+
+
+		/// \brief Calls f(i) for all i in [0, count) on max_threads threads
+		///
+		/// max_threads = 0 uses all hardware threads.
+		template < typename F >
+		void parallel_for(std::size_t count, F const& f, std::size_t max_threads = 0){
+			if(max_threads == 0){
+				max_threads = std::max< std::size_t >(1, std::thread::hardware_concurrency());
+			}
+
+			std::size_t const threads = std::min(count, max_threads);
+
+			if(threads <= 1){
+				for(std::size_t i = 0; i < count; ++i) f(i);
+				return;
+			}
+
+			std::atomic< std::size_t > next(0);
+			auto const worker = [&]{
+				for(std::size_t i = next++; i < count; i = next++) f(i);
+			};
+
+			std::vector< std::future< void > > futures;
+			futures.reserve(threads - 1);
+			for(std::size_t i = 1; i < threads; ++i){
+				futures.push_back(std::async(std::launch::async, worker));
+			}
+
+			worker();
+
+			for(auto& future: futures) future.get();
+		}
+
+
+		/// \brief Get the rows per block for blocks of about 64 KiB
+		template < typename ValueType >
+		std::uint32_t default_rows_per_block(std::uint64_t width){
+			std::uint64_t const row_bytes = std::max< std::uint64_t >(1, width * sizeof(ValueType));
+			return static_cast< std::uint32_t >(std::max< std::uint64_t >(1, (64 * 1024) / row_bytes));
+		}
+
+		/// \brief Get the count of blocks in a compressed payload
+		inline std::uint64_t block_count(header const& header){
+			return header.height / header.rows_per_block + (header.height % header.rows_per_block != 0 ? 1 : 0);
+		}
+
+		/// \brief Get the count of bytes behind the position of a stream, max if unknown
+		inline std::uint64_t remaining_bytes(std::istream& is){
+			auto const pos = is.tellg();
+			if(pos < 0) return std::numeric_limits< std::uint64_t >::max();
+
+			is.seekg(0, std::ios_base::end);
+			auto const end = is.tellg();
+			is.seekg(pos);
+			if(end < 0 || !is.good()) return std::numeric_limits< std::uint64_t >::max();
+
+			return end > pos ? static_cast< std::uint64_t >(end - pos) : 0;
+		}
+
+		/// \brief Read count values, the memory grows only with the data that arrives
+		/// \throw tools::big::big_error
+		template < typename T >
+		void read_values(std::istream& is, std::vector< T >& target, std::uint64_t count){
+			constexpr std::size_t chunk_size = (1 << 20) / sizeof(T);
+
+			target.clear();
+			while(target.size() < count){
+				auto const pos = target.size();
+				auto const size = static_cast< std::size_t >(std::min< std::uint64_t >(count - pos, chunk_size));
+				target.resize(pos + size);
+				is.read(reinterpret_cast< char* >(target.data() + pos), size * sizeof(T));
+				if(!is.good()){
+					throw big_error("Can't read big content");
+				}
+			}
+		}
+
+		/// \brief Throws if the parameters of a compressed payload are unknown
+		template < typename ValueType >
+		void check_compression(header const& header){
+			if(header.codec != static_cast< std::uint8_t >(tools::big::codec::lz4)){
+				throw big_error("Unsupported compression codec");
+			}
+
+			if(header.filter > static_cast< std::uint8_t >(tools::big::filter::delta_shuffle)){
+				throw big_error("Unsupported compression filter");
+			}
+
+			if(header.rows_per_block == 0){
+				throw big_error("Corrupt big header");
+			}
+
+			if(header.channels != 1 || header.frames != 1 || header.row_stride != 0){
+				throw big_error("Compressed payloads are supported only for single bitmaps");
+			}
+		}
+
+		/// \brief Throws if the payload is compressed
+		inline void check_uncompressed(header const& header){
+			if(header.placeholder & header_flags::compressed){
+				throw big_error("Compressed big file needs to be read by tools::big::read");
+			}
+		}
+
+		/// \brief Set the compression fields in a header
+		template < typename ValueType >
+		void set_compression(header& header, compression const& compression){
+			auto const filter = compression.filter == tools::big::filter::automatic ?
+				default_filter< ValueType >() : compression.filter;
+
+			if(filter == tools::big::filter::delta_shuffle && !has_delta< sizeof(ValueType) >::value){
+				throw big_error("Delta filter is not supported for this value type");
+			}
+
+			header.placeholder |= header_flags::extended | header_flags::compressed;
+			header.codec = static_cast< std::uint8_t >(compression.codec);
+			header.filter = static_cast< std::uint8_t >(filter);
+			header.rows_per_block = compression.rows_per_block != 0 ?
+				compression.rows_per_block : default_rows_per_block< ValueType >(header.width);
+		}
+
+
+		/// \brief Filter and compress one block of rows
+		template < typename ValueType >
+		std::vector< unsigned char > compress_block(
+			bitmap_view< ValueType > view, header const& header, std::size_t first_row
+		){
+			using value_type = typename bitmap_view< ValueType >::value_type;
+
+			std::size_t const rows = std::min< std::size_t >(header.rows_per_block, view.height() - first_row);
+			std::size_t const count = view.width() * rows;
+			std::size_t const bytes = count * sizeof(value_type);
+
+			std::vector< unsigned char > raw(bytes);
+			for(std::size_t y = 0; y < rows; ++y){
+				auto const row = reinterpret_cast< value_type* >(raw.data()) + y * view.width();
+				nan_to_undef(view.row(first_row + y), row, view.width());
+			}
+
+			auto const filter = static_cast< tools::big::filter >(header.filter);
+
+			if(filter == tools::big::filter::delta_shuffle){
+				delta_encode< sizeof(value_type) >(raw.data(), view.width(), rows, has_delta< sizeof(value_type) >());
+			}
+
+			if(filter != tools::big::filter::none){
+				std::vector< unsigned char > shuffled(bytes);
+				shuffle(raw.data(), shuffled.data(), count, sizeof(value_type));
+				raw.swap(shuffled);
+			}
+
+			std::vector< unsigned char > result(lz4::compress_bound(bytes));
+			result.resize(lz4::compress(raw.data(), bytes, result.data()));
+
+			// incompressible blocks are stored as they are
+			if(result.size() >= bytes){
+				return raw;
+			}
+
+			return result;
+		}
+
+		/// \brief Decompress and unfilter one block of rows to raw values
+		template < typename ValueType >
+		void decompress_block(
+			unsigned char const* in, std::size_t in_size,
+			std::vector< unsigned char >& out, std::vector< unsigned char >& buffer,
+			header const& header, std::size_t rows
+		){
+			std::size_t const count = header.width * rows;
+			std::size_t const bytes = count * sizeof(ValueType);
+			auto const filter = static_cast< tools::big::filter >(header.filter);
+
+			out.resize(bytes);
+
+			unsigned char* target = out.data();
+			if(filter != tools::big::filter::none){
+				buffer.resize(bytes);
+				target = buffer.data();
+			}
+
+			if(in_size == bytes){
+				std::memcpy(target, in, bytes);
+			}else{
+				lz4::decompress(in, in_size, target, bytes);
+			}
+
+			if(filter != tools::big::filter::none){
+				unshuffle(buffer.data(), out.data(), count, sizeof(ValueType));
+			}
+
+			if(filter == tools::big::filter::delta_shuffle){
+				delta_decode< sizeof(ValueType) >(out.data(), header.width, rows, has_delta< sizeof(ValueType) >());
+			}
+		}
+
+
+		/// \brief Write the block table and the blocks of a compressed payload
+		template < typename ValueType >
+		void write_compressed_frame(bitmap_view< ValueType > view, header const& header, std::ostream& os){
+			auto const count = static_cast< std::size_t >(block_count(header));
+
+			std::vector< std::vector< unsigned char > > blocks(count);
+			parallel_for(count, [&](std::size_t i){
+				blocks[i] = compress_block(view, header, i * header.rows_per_block);
+			});
+
+			std::vector< std::uint64_t > table(count);
+			for(std::size_t i = 0; i < count; ++i){
+				table[i] = blocks[i].size();
+			}
+
+			os.write(reinterpret_cast< char const* >(table.data()), table.size() * sizeof(std::uint64_t));
+			for(auto const& block: blocks){
+				os.write(reinterpret_cast< char const* >(block.data()), block.size());
+			}
+
+			if(!os.good()){
+				throw big_error("Can't write big content");
+			}
+		}
+
+		/// \brief Read a region of a compressed payload
+		///
+		/// The stream must be positioned on the block table. Only the blocks
+		/// that contain rows of the region are read and they are decoded in
+		/// parallel.
+		///
+		/// \param view Target with the size of the region
+		/// \param x Left column of the region in the file
+		/// \param y Top row of the region in the file
+		template < typename ValueType >
+		void read_compressed_frame(
+			bitmap_view< ValueType > view, std::istream& is, header const& header,
+			std::size_t x = 0, std::size_t y = 0
+		){
+			static_assert(!std::is_const< ValueType >::value, "Can't read into a const_bitmap_view");
+
+			check_compression< ValueType >(header);
+
+			if(x + view.width() > header.width || y + view.height() > header.height){
+				throw big_error("Region is outside of the big file");
+			}
+
+			auto const count = block_count(header);
+
+			// the table and the blocks must be in the stream, values of a
+			// corrupt file must neither cause huge allocations nor overflow
+			auto remaining = remaining_bytes(is);
+			if(count > remaining / sizeof(std::uint64_t)){
+				throw big_error("Can't read big content");
+			}
+			remaining -= count * sizeof(std::uint64_t);
+
+			std::vector< std::uint64_t > table;
+			read_values(is, table, count);
+
+			std::uint64_t const row_size = header.width * sizeof(ValueType);
+			for(std::size_t i = 0; i < table.size(); ++i){
+				std::uint64_t const block_y = std::uint64_t(i) * header.rows_per_block;
+				std::uint64_t const rows = std::min< std::uint64_t >(header.rows_per_block, header.height - block_y);
+				if(table[i] > lz4::compress_bound(static_cast< std::size_t >(row_size * rows)) || table[i] > remaining){
+					throw big_error("Corrupt compressed block table");
+				}
+				remaining -= table[i];
+			}
+
+			if(view.height() == 0 || view.width() == 0) return;
+
+			std::size_t const first_block = y / header.rows_per_block;
+			std::size_t const last_block = (y + view.height() - 1) / header.rows_per_block;
+
+			// offsets of the blocks relative to the first needed block, the
+			// sums can't overflow because they are smaller than the stream
+			std::vector< std::uint64_t > offsets(last_block - first_block + 2, 0);
+			std::uint64_t skip = 0;
+			for(std::size_t i = 0; i < first_block; ++i){
+				skip += table[i];
+			}
+			for(std::size_t i = first_block; i <= last_block; ++i){
+				offsets[i - first_block + 1] = offsets[i - first_block] + table[i];
+			}
+
+			if(skip > 0){
+				is.seekg(static_cast< std::streamoff >(skip), std::ios_base::cur);
+			}
+
+			std::vector< unsigned char > data;
+			read_values(is, data, offsets.back());
+
+			parallel_for(last_block - first_block + 1, [&](std::size_t i){
+				std::size_t const block_y = (first_block + i) * header.rows_per_block;
+				std::size_t const rows = std::min< std::size_t >(header.rows_per_block, header.height - block_y);
+
+				std::vector< unsigned char > raw;
+				std::vector< unsigned char > buffer;
+				decompress_block< ValueType >(
+					data.data() + offsets[i], static_cast< std::size_t >(offsets[i + 1] - offsets[i]),
+					raw, buffer, header, rows
+				);
+
+				std::size_t const begin = std::max(block_y, y);
+				std::size_t const end = std::min(block_y + rows, y + view.height());
+				for(std::size_t row = begin; row < end; ++row){
+					auto const source = reinterpret_cast< ValueType const* >(raw.data()) + (row - block_y) * header.width + x;
+					undef_to_nan(source, view.row(row - y), view.width());
+				}
+			});
+		}
+
+
+	} }
+
+
+} }
+
+#endif
@@ -0,0 +1,327 @@
+/// \file tools/big_header.hpp
+/// \author Benjamin Buch (benni.buch@gmail.com)
+/// \brief struct tools::big::header and its serialization
+///
+/// Copyright (c) 2009-2015 Benjamin Buch (benni dot buch at gmail dot com)
+///
+/// Distributed under the Boost Software License, Version 1.0. (See accompanying
+/// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+///
+#ifndef _tools_big_header_hpp_INCLUDED_
+#define _tools_big_header_hpp_INCLUDED_
+
+#include "big_types.hpp"
+#include "big_exception.hpp"
+
+#include <array>
+#include <string>
+#include <limits>
+#include <cstring>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+
+namespace tools { namespace big {
+
+
+	/// \brief Bits in the placeholder field of the header
+	struct header_flags{
+		enum value: std::uint32_t{
+			/// \brief An extended header with 64 bit dimensions follows the 10 byte header
+			extended = 0x01,
+
+			/// \brief The payload is compressed in blocks of rows, requires extended
+			compressed = 0x02
+		};
+	};
+
+
+	/// \brief Header of a big file
+	///
+	/// A big file starts with 10 bytes: width, height and type as 16 bit values
+	/// and the 32 bit placeholder. If the flag header_flags::extended is set in
+	/// placeholder, the 16 bit width and height are 0 and an extended header
+	/// follows:
+	///
+	/// offset | size | content
+	/// -------|------|------------------------------------
+	///     10 |    2 | version (1)
+	///     12 |    2 | reserved (0)
+	///     14 |    4 | data_offset, start of the data
+	///     18 |    4 | channels, interleaved per pixel
+	///     22 |    8 | width
+	///     30 |    8 | height
+	///     38 |    8 | frames, stored back to back
+	///     46 |    8 | row_stride in bytes, 0 for no padding
+	///     54 |    1 | codec of a compressed payload
+	///     55 |    1 | filter of a compressed payload
+	///     56 |    4 | rows_per_block of a compressed payload
+	///     60 |    4 | reserved (0)
+	struct header{
+		std::uint64_t width;
+		std::uint64_t height;
+		std::uint16_t type;
+		std::uint32_t placeholder;
+		std::uint32_t channels = 1;
+		std::uint64_t frames = 1;
+		std::uint64_t row_stride = 0;
+		std::uint32_t data_offset = 10;
+		std::uint8_t codec = 0;
+		std::uint8_t filter = 0;
+		std::uint32_t rows_per_block = 0;
+	};
+
+
+	/// \brief Size of the classic header
+	constexpr std::size_t header_size = 10;
+
+	/// \brief Size of the header with extension
+	constexpr std::size_t extended_header_size = 64;
+
+	/// \brief Version of the extended header
+	constexpr std::uint16_t extended_header_version = 1;
+
+
+	/// \brief Make a header for a file with value type ValueType
+	template < typename ValueType >
+	header make_header(std::uint64_t width, std::uint64_t height, std::uint32_t channels = 1, std::uint64_t frames = 1);
+
+	/// \brief Get the distance between two rows in the file in bytes
+	template < typename ValueType >
+	std::uint64_t row_bytes(header const& header);
+
+	/// \brief Get the size of one frame in the file in bytes
+	template < typename ValueType >
+	std::uint64_t frame_bytes(header const& header);
+
+	/// \brief Get true, if the header can be stored in the classic 10 byte format
+	bool is_classic(header const& header);
+
+	/// \brief Loads the type-information of a big file from a std::istream
+	/// \throw tools::big::big_error
+	header read_header(std::istream& is);
+
+	/// \brief Writes the header, the classic format is used if possible
+	///
+	/// The stream is positioned on the start of the data afterwards.
+	///
+	/// \throw tools::big::big_error
+	void write_header(header const& header, std::ostream& os);
+
+
+	//=============================================================================
+	// Implementation
+	//=============================================================================
+
+	namespace impl{ namespace big{
+
+
+		template < typename T >
+		inline T get(char const* data, std::size_t offset){
+			T result;
+			std::memcpy(&result, data + offset, sizeof(T));
+			return result;
+		}
+
+		template < typename T >
+		inline void set(char* data, std::size_t offset, T const& value){
+			std::memcpy(data + offset, &value, sizeof(T));
+		}
+
+		/// \brief Decode the first 10 bytes of a header
+		inline header parse_classic_header(char const* data){
+			header header;
+			header.width       = get< std::uint16_t >(data, 0);
+			header.height      = get< std::uint16_t >(data, 2);
+			header.type        = get< std::uint16_t >(data, 4);
+			header.placeholder = get< std::uint32_t >(data, 6);
+			return header;
+		}
+
+		/// \brief Throws if a size in the header overflows a 64 bit byte count
+		///
+		/// All checks are divisions. Afterwards row_bytes, frame_bytes and
+		/// data_offset + frames * frame_bytes can be computed without overflow.
+		inline void check_sizes(header const& header, std::uint64_t value_size){
+			constexpr auto max = std::numeric_limits< std::uint64_t >::max();
+
+			if(header.channels == 0 || value_size == 0 || header.width > max / header.channels / value_size){
+				throw big_error("Corrupt big header");
+			}
+
+			std::uint64_t const row_size = header.row_stride != 0 ?
+				header.row_stride : header.width * header.channels * value_size;
+			if(row_size != 0 && header.height > max / row_size){
+				throw big_error("Corrupt big header");
+			}
+
+			std::uint64_t const frame_size = row_size * header.height;
+			if(frame_size != 0 && header.frames > (max - header.data_offset) / frame_size){
+				throw big_error("Corrupt big header");
+			}
+		}
+
+		/// \brief Throws if the type isn't one of the types the readers of big files support
+		///
+		/// long double is not included, its size differs between platforms.
+		inline void check_known_type(header const& header){
+			switch(header.type){
+				case type< std::uint8_t >::value:
+				case type< std::uint16_t >::value:
+				case type< std::uint32_t >::value:
+				case type< std::uint64_t >::value:
+				case type< float >::value:
+				case type< double >::value:
+					return;
+			}
+
+			throw big_error("Unsupported type in file");
+		}
+
+		/// \brief Decode the extension of a header
+		inline void parse_extended_header(header& header, char const* data){
+			if(get< std::uint16_t >(data, 10) != extended_header_version){
+				throw big_error("Unsupported big header version");
+			}
+
+			header.data_offset = get< std::uint32_t >(data, 14);
+			header.channels    = get< std::uint32_t >(data, 18);
+			header.width       = get< std::uint64_t >(data, 22);
+			header.height      = get< std::uint64_t >(data, 30);
+			header.frames      = get< std::uint64_t >(data, 38);
+			header.row_stride  = get< std::uint64_t >(data, 46);
+			header.codec       = get< std::uint8_t  >(data, 54);
+			header.filter      = get< std::uint8_t  >(data, 55);
+			header.rows_per_block = get< std::uint32_t >(data, 56);
+
+			if(header.data_offset < extended_header_size || header.channels == 0){
+				throw big_error("Corrupt big header");
+			}
+
+			// the last 4 bits of the type are the value size, check_type checks
+			// again with the size of the value type of the reader
+			auto const value_size = header.type & 0x000F;
+			check_sizes(header, value_size != 0 ? value_size : 1);
+		}
+
+		/// \brief Decode a complete header from memory
+		inline header parse_header(char const* data, std::size_t bytes){
+			if(bytes < header_size){
+				throw big_error("Can't read big header");
+			}
+
+			header header = parse_classic_header(data);
+
+			if(header.placeholder & header_flags::extended){
+				if(bytes < extended_header_size){
+					throw big_error("Can't read big header");
+				}
+
+				parse_extended_header(header, data);
+			}
+
+			return header;
+		}
+
+
+	} }
+
+
+	template < typename ValueType >
+	header make_header(std::uint64_t width, std::uint64_t height, std::uint32_t channels, std::uint64_t frames){
+		header header;
+		header.width = width;
+		header.height = height;
+		header.type = big::type< ValueType >::value;
+		header.placeholder = 0;
+		header.channels = channels;
+		header.frames = frames;
+		return header;
+	}
+
+	template < typename ValueType >
+	std::uint64_t row_bytes(header const& header){
+		return header.row_stride != 0 ? header.row_stride : header.width * header.channels * sizeof(ValueType);
+	}
+
+	template < typename ValueType >
+	std::uint64_t frame_bytes(header const& header){
+		return row_bytes< ValueType >(header) * header.height;
+	}
+
+	inline bool is_classic(header const& header){
+		return
+			header.width  <= std::numeric_limits< std::uint16_t >::max() &&
+			header.height <= std::numeric_limits< std::uint16_t >::max() &&
+			header.channels == 1 &&
+			header.frames == 1 &&
+			header.row_stride == 0 &&
+			(header.placeholder & ~std::uint32_t(header_flags::extended)) == 0;
+	}
+
+	inline header read_header(std::istream& is){
+		std::array< char, extended_header_size > buffer;
+
+		// read the file header (10 Byte)
+		is.read(buffer.data(), header_size);
+
+		if(!is.good()){
+			throw big_error("Can't read big header");
+		}
+
+		header header = impl::big::parse_classic_header(buffer.data());
+
+		if(header.placeholder & header_flags::extended){
+			is.read(buffer.data() + header_size, extended_header_size - header_size);
+
+			if(!is.good()){
+				throw big_error("Can't read big header");
+			}
+
+			impl::big::parse_extended_header(header, buffer.data());
+
+			// skip unknown header data of later versions
+			is.ignore(header.data_offset - extended_header_size);
+
+			if(!is.good()){
+				throw big_error("Can't read big header");
+			}
+		}
+
+		return header;
+	}
+
+	inline void write_header(header const& header, std::ostream& os){
+		std::array< char, extended_header_size > buffer{};
+
+		bool const classic = is_classic(header);
+
+		impl::big::set< std::uint16_t >(buffer.data(), 0, classic ? static_cast< std::uint16_t >(header.width) : 0);
+		impl::big::set< std::uint16_t >(buffer.data(), 2, classic ? static_cast< std::uint16_t >(header.height) : 0);
+		impl::big::set< std::uint16_t >(buffer.data(), 4, header.type);
+		impl::big::set< std::uint32_t >(buffer.data(), 6, classic ? header.placeholder : header.placeholder | header_flags::extended);
+
+		if(!classic){
+			impl::big::set< std::uint16_t >(buffer.data(), 10, extended_header_version);
+			impl::big::set< std::uint32_t >(buffer.data(), 14, std::uint32_t(extended_header_size));
+			impl::big::set< std::uint32_t >(buffer.data(), 18, header.channels);
+			impl::big::set< std::uint64_t >(buffer.data(), 22, header.width);
+			impl::big::set< std::uint64_t >(buffer.data(), 30, header.height);
+			impl::big::set< std::uint64_t >(buffer.data(), 38, header.frames);
+			impl::big::set< std::uint64_t >(buffer.data(), 46, header.row_stride);
+			impl::big::set< std::uint8_t  >(buffer.data(), 54, header.codec);
+			impl::big::set< std::uint8_t  >(buffer.data(), 55, header.filter);
+			impl::big::set< std::uint32_t >(buffer.data(), 56, header.rows_per_block);
+		}
+
+		os.write(buffer.data(), classic ? header_size : extended_header_size);
+
+		if(!os.good()){
+			throw big_error("Can't write big header");
+		}
+	}
+
+
+} }
+
+#endif
@@ -0,0 +1,239 @@
+/// \file tools/big_mapped_read.hpp
+/// \author Benjamin Buch (benni.buch@gmail.com)
+/// \brief class template tools::big::mapped_bitmap
+///
+/// Copyright (c) 2015 Benjamin Buch (benni dot buch at gmail dot com)
+///
+/// Distributed under the Boost Software License, Version 1.0. (See accompanying
+/// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+///
+#ifndef _tools_big_mapped_read_hpp_INCLUDED_
+#define _tools_big_mapped_read_hpp_INCLUDED_
+
+#include "big_types.hpp"
+#include "big_exception.hpp"
+#include "big_read.hpp"
+#include "big_undef_conversion.hpp"
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <string>
+#include <memory>
+#include <cstring>
+#include <cstdint>
+
+namespace tools { namespace big {
+
+
+	/// \brief Read only view to the content of a big file in memory
+	///
+	/// The file is mapped into memory instead of read. Loading costs only the
+	/// setup of the page table, the data is read by the operating system on the
+	/// first access. The undef to NaN conversion of floating point types is done
+	/// on every access, the mapped data is never modified.
+	template < typename ValueType >
+	class mapped_bitmap{
+	public:
+		/// \brief Type of the data that administrates the bitmap
+		using value_type = ValueType;
+
+		/// \brief Type of points in the bitmap
+		using point_type = tools::point< std::size_t >;
+
+		/// \brief Type of bitmap size
+		using size_type = tools::size< std::size_t >;
+
+
+		/// \brief Constructs an empty view
+		mapped_bitmap() = default;
+
+		/// \brief Maps a big file by a given filename
+		/// \throw tools::big::big_error
+		explicit mapped_bitmap(std::string const& filename);
+
+		/// \brief Views a complete big file that is already in memory
+		///
+		/// owner keeps the memory alive as long as the view exists.
+		///
+		/// \throw tools::big::big_error
+		mapped_bitmap(std::shared_ptr< void const > owner, char const* data, std::size_t bytes);
+
+		/// \brief Views the payload of a frame without header
+		///
+		/// owner keeps the memory alive as long as the view exists.
+		mapped_bitmap(std::shared_ptr< void const > owner, unsigned char const* data, size_type const& size, std::size_t row_stride):
+			owner_(std::move(owner)),
+			size_(size),
+			row_stride_(row_stride),
+			data_(data)
+			{}
+
+
+		/// \brief Get the width
+		std::size_t width()const{
+			return size_.width();
+		}
+
+		/// \brief Get the height
+		std::size_t height()const{
+			return size_.height();
+		}
+
+		/// \brief Get the size
+		size_type const size()const{
+			return size_;
+		}
+
+		/// \brief Get the number of points in the bitmap
+		std::size_t point_count()const{
+			return size_.point_count();
+		}
+
+
+		/// \brief Get the value by local coordinates, undef is converted to NaN
+		value_type operator()(std::size_t x, std::size_t y)const{
+			return operator()(point_type(x, y));
+		}
+
+		/// \brief Get the value by local coordinates, undef is converted to NaN
+		value_type operator()(point_type const& point)const{
+			value_type value;
+			std::memcpy(&value, data_ + point.y() * row_stride_ + point.x() * sizeof(value_type), sizeof(value_type));
+			return impl::big::undef_to_nan(value);
+		}
+
+
+		/// \brief Get a pointer to the unconverted payload of the file
+		///
+		/// The pointer is not aligned for value_type.
+		unsigned char const* raw_data()const{
+			return data_;
+		}
+
+		/// \brief Get the distance between two rows in the payload in bytes
+		std::size_t row_stride()const{
+			return row_stride_;
+		}
+
+
+		/// \brief Copy the data to a bitmap, undef is converted to NaN
+		template < typename Layout >
+		void copy_to(bitmap< value_type, Layout >& bitmap)const;
+
+		/// \brief Copy the data to the memory of a view with the same size, undef is converted to NaN
+		/// \throw tools::big::big_error
+		void copy_to(bitmap_view< value_type > view)const;
+
+
+	private:
+		/// \brief Check the header and set size_ and data_
+		void init(char const* data, std::size_t bytes);
+
+		/// \brief Keeps the memory alive
+		std::shared_ptr< void const > owner_;
+
+		/// \brief Size of the bitmap
+		size_type size_{0, 0};
+
+		/// \brief Distance between two rows in bytes
+		std::size_t row_stride_ = 0;
+
+		/// \brief Pointer to the first byte behind the header
+		unsigned char const* data_ = nullptr;
+	};
+
+
+	//=============================================================================
+	// Implementation
+	//=============================================================================
+
+	namespace impl{ namespace big{
+
+
+		/// \brief A read only memory mapped file
+		struct mapped_file{
+			mapped_file(std::string const& filename):
+				file(filename.c_str(), boost::interprocess::read_only),
+				region(file, boost::interprocess::read_only)
+				{}
+
+			boost::interprocess::file_mapping file;
+			boost::interprocess::mapped_region region;
+		};
+
+
+	} }
+
+
+	template < typename ValueType >
+	mapped_bitmap< ValueType >::mapped_bitmap(std::string const& filename){
+		std::shared_ptr< impl::big::mapped_file > file;
+
+		try{
+			file = std::make_shared< impl::big::mapped_file >(filename);
+		}catch(boost::interprocess::interprocess_exception const& error){
+			throw big_error("Can't map file (" + std::string(error.what()) + "): " + filename);
+		}
+
+		try{
+			init(static_cast< char const* >(file->region.get_address()), file->region.get_size());
+		}catch(big_error const& error){
+			throw big_error(std::string(error.what()) + ": " + filename);
+		}
+
+		owner_ = std::move(file);
+	}
+
+	template < typename ValueType >
+	mapped_bitmap< ValueType >::mapped_bitmap(std::shared_ptr< void const > owner, char const* data, std::size_t bytes):
+		owner_(std::move(owner))
+	{
+		init(data, bytes);
+	}
+
+	template < typename ValueType >
+	void mapped_bitmap< ValueType >::init(char const* data, std::size_t bytes){
+		header const header = impl::big::parse_header(data, bytes);
+
+		impl::big::check_type< value_type >(header);
+		impl::big::check_single_bitmap(header);
+		impl::big::check_uncompressed(header);
+
+		if(
+			bytes < header.data_offset ||
+			bytes - header.data_offset < frame_bytes< value_type >(header)
+		){
+			throw big_error("Can't read big content");
+		}
+
+		size_.set(header.width, header.height);
+		row_stride_ = row_bytes< value_type >(header);
+		data_ = reinterpret_cast< unsigned char const* >(data + header.data_offset);
+	}
+
+	template < typename ValueType >
+	template < typename Layout >
+	void mapped_bitmap< ValueType >::copy_to(bitmap< value_type, Layout >& bitmap)const{
+		bitmap.resize(size_, tools::uninitialized);
+		copy_to(bitmap_view< value_type >(bitmap));
+	}
+
+	template < typename ValueType >
+	void mapped_bitmap< ValueType >::copy_to(bitmap_view< value_type > view)const{
+		if(!(view.size() == size_)){
+			throw big_error("Size of view is not compatible");
+		}
+
+		for(std::size_t y = 0; y < height(); ++y){
+			auto const row = view.row(y);
+
+			std::memcpy(row, data_ + y * row_stride_, width() * sizeof(value_type));
+			impl::big::undef_to_nan(row, row, width());
+		}
+	}
+
+
+} }
+
+#endif
@@ -0,0 +1,240 @@
+/// \file tools/big_probe.hpp
+/// \author Benjamin Buch (benni.buch@gmail.com)
+/// \brief Header-only probing and directory scanning for big files
+///
+/// This header is not part of big.hpp, because it requires linking boost_filesystem.
+///
+/// Copyright (c) 2015 Benjamin Buch (benni dot buch at gmail dot com)
+///
+/// Distributed under the Boost Software License, Version 1.0. (See accompanying
+/// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+///
+#ifndef _tools_big_probe_hpp_INCLUDED_
+#define _tools_big_probe_hpp_INCLUDED_
+
+#include "big_header.hpp"
+#include "big_exception.hpp"
+#include "big_compression.hpp"
+
+#include <boost/filesystem.hpp>
+
+#include <array>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <limits>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define TOOLS_BIG_PROBE_POSIX
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+namespace tools { namespace big {
+
+
+	/// \brief Header and size of a big file
+	struct file_info{
+		/// \brief Path of the file
+		std::string path;
+
+		/// \brief Header of the file
+		big::header header;
+
+		/// \brief Size of the file in bytes
+		std::uint64_t file_size;
+	};
+
+	/// \brief A file that could not be probed
+	struct file_error{
+		/// \brief Path of the file
+		std::string path;
+
+		/// \brief Message of the error
+		std::string message;
+	};
+
+	/// \brief Result of a directory scan
+	struct directory_index{
+		/// \brief All valid big files, sorted by path
+		std::vector< file_info > files;
+
+		/// \brief All big files that could not be probed, sorted by path
+		std::vector< file_error > errors;
+	};
+
+
+	/// \brief Reads the header of a big file and checks its type and its sizes against the file size
+	///
+	/// On POSIX systems the header is read by a single pread without stream
+	/// construction, the file size is taken from fstat of the same descriptor.
+	///
+	/// \throw tools::big::big_error
+	file_info probe(std::string const& filename);
+
+	/// \brief Probes all files with extension .big in a directory in parallel
+	///
+	/// \param directory Directory to scan
+	/// \param recursive Scan subdirectories too
+	/// \param threads Count of threads, 0 for 4 threads per hardware thread
+	///
+	/// \throw tools::big::big_error if the directory can't be read
+	directory_index scan_directory(std::string const& directory, bool recursive = false, std::size_t threads = 0);
+
+
+	//=============================================================================
+	// Implementation
+	//=============================================================================
+
+	namespace impl{ namespace big{
+
+
+		/// \brief Read up to extended_header_size bytes from the start of a file
+		///
+		/// \return Count of read bytes
+		inline std::size_t read_file_start(
+			std::string const& filename, std::array< char, extended_header_size >& buffer, std::uint64_t& file_size
+		){
+#ifdef TOOLS_BIG_PROBE_POSIX
+			int const fd = ::open(filename.c_str(), O_RDONLY);
+			if(fd < 0){
+				throw big_error("Can't open file: " + filename);
+			}
+
+			struct stat status;
+			auto const bytes = ::pread(fd, buffer.data(), buffer.size(), 0);
+			auto const stat_result = ::fstat(fd, &status);
+			::close(fd);
+
+			if(bytes < 0 || stat_result != 0){
+				throw big_error("Can't read big header: " + filename);
+			}
+
+			file_size = static_cast< std::uint64_t >(status.st_size);
+			return static_cast< std::size_t >(bytes);
+#else
+			std::ifstream is(filename.c_str(), std::ios_base::in | std::ios_base::binary | std::ios_base::ate);
+			if(!is.is_open()){
+				throw big_error("Can't open file: " + filename);
+			}
+
+			file_size = static_cast< std::uint64_t >(is.tellg());
+			is.seekg(0);
+			is.read(buffer.data(), buffer.size());
+			return static_cast< std::size_t >(is.gcount());
+#endif
+		}
+
+		/// \brief Get the minimal size of a file with this header
+		///
+		/// The type must be known, the products can't overflow after check_sizes.
+		inline std::uint64_t min_file_size(header const& header){
+			// The last 4 bits in the type get the size of a single value
+			std::uint64_t const value_size = header.type & 0x000F;
+			check_sizes(header, value_size);
+
+			if(header.placeholder & header_flags::compressed){
+				if(header.rows_per_block == 0){
+					throw big_error("Corrupt big header");
+				}
+
+				auto const count = block_count(header);
+				if(count > (std::numeric_limits< std::uint64_t >::max() - header.data_offset) / sizeof(std::uint64_t)){
+					throw big_error("Corrupt big header");
+				}
+
+				return header.data_offset + count * sizeof(std::uint64_t);
+			}
+
+			std::uint64_t const row_bytes = header.row_stride != 0 ?
+				header.row_stride : header.width * header.channels * value_size;
+
+			return header.data_offset + header.frames * header.height * row_bytes;
+		}
+
+
+	} }
+
+
+	inline file_info probe(std::string const& filename){
+		std::array< char, extended_header_size > buffer;
+		file_info result;
+		result.path = filename;
+
+		auto const bytes = impl::big::read_file_start(filename, buffer, result.file_size);
+
+		try{
+			result.header = impl::big::parse_header(buffer.data(), bytes);
+			impl::big::check_known_type(result.header);
+
+			if(result.file_size < impl::big::min_file_size(result.header)){
+				throw big_error("File is smaller than its header requires");
+			}
+		}catch(big_error const& error){
+			throw big_error(std::string(error.what()) + ": " + filename);
+		}
+
+		return result;
+	}
+
+	inline directory_index scan_directory(std::string const& directory, bool recursive, std::size_t threads){
+		namespace fs = boost::filesystem;
+
+		std::vector< std::string > paths;
+
+		try{
+			auto const add = [&paths](fs::directory_entry const& entry){
+				if(fs::is_regular_file(entry.status()) && entry.path().extension() == ".big"){
+					paths.push_back(entry.path().string());
+				}
+			};
+
+			if(recursive){
+				for(auto const& entry: fs::recursive_directory_iterator(directory)) add(entry);
+			}else{
+				for(auto const& entry: fs::directory_iterator(directory)) add(entry);
+			}
+		}catch(fs::filesystem_error const& error){
+			throw big_error("Can't scan directory (" + std::string(error.what()) + "): " + directory);
+		}
+
+		std::sort(paths.begin(), paths.end());
+
+		// the work is dominated by waiting for the disk, so use more threads than cores
+		if(threads == 0){
+			threads = 4 * std::max< std::size_t >(1, std::thread::hardware_concurrency());
+		}
+
+		std::vector< file_info > infos(paths.size());
+		std::vector< std::string > messages(paths.size());
+
+		impl::big::parallel_for(paths.size(), [&](std::size_t i){
+			try{
+				infos[i] = probe(paths[i]);
+			}catch(std::exception const& error){
+				messages[i] = error.what();
+			}
+		}, threads);
+
+		directory_index result;
+		for(std::size_t i = 0; i < paths.size(); ++i){
+			if(messages[i].empty()){
+				result.files.push_back(std::move(infos[i]));
+			}else{
+				result.errors.push_back(file_error{paths[i], std::move(messages[i])});
+			}
+		}
+
+		return result;
+	}
+
+
+} }
+
+#undef TOOLS_BIG_PROBE_POSIX
+
+#endif
@@ -12,8 +12,11 @@
 #define _tools_big_read_hpp_INCLUDED_
 
 #include "big_types.hpp"
+#include "big_header.hpp"
 #include "big_exception.hpp"
+#include "big_compression.hpp"
 #include "big_undef_conversion.hpp"
+#include "bitmap_view.hpp"
 
 #include <string>
 #include <fstream>
@@ -22,14 +25,6 @@
 namespace tools { namespace big {
 
 
-	/// \brief Header of a big file
-	struct header{
-		std::uint16_t width;
-		std::uint16_t height;
-		std::uint16_t type;
-		std::uint32_t placeholder;
-	};
-
 	/// \brief Loads a big file by a given filename
 	/// \throw tools::big::big_error
 	template < typename BitmapType >
@@ -40,21 +35,197 @@ namespace tools { namespace big {
 	template < typename BitmapType >
 	void read(BitmapType& bitmap, std::istream& is);
 
-	/// \brief Loads the type-information of a big file from a std::istream
+	/// \brief Loads a big file by a given filename into the memory of a tools::bitmap_view
+	///
+	/// The size of the view must be equal to the size in the file.
+	///
+	/// \throw tools::big::big_error
+	template < typename ValueType >
+	void read(bitmap_view< ValueType > view, std::string const& filename);
+
+	/// \brief Loads a big file from a std::istream into the memory of a tools::bitmap_view
+	///
+	/// The size of the view must be equal to the size in the file.
+	///
+	/// \throw tools::big::big_error
+	template < typename ValueType >
+	void read(bitmap_view< ValueType > view, std::istream& is);
+
+	/// \brief Loads a rectangular region of a big file by a given filename
+	///
+	/// Only the rows and columns of the region are read from the file.
+	///
+	/// \throw tools::big::big_error
+	template < typename BitmapType >
+	void read_region(BitmapType& bitmap, std::string const& filename, tools::rect< std::size_t > const& region);
+
+	/// \brief Loads a rectangular region of a big file from a seekable std::istream
+	/// \throw tools::big::big_error
+	template < typename BitmapType >
+	void read_region(BitmapType& bitmap, std::istream& is, tools::rect< std::size_t > const& region);
+
+	/// \brief Loads a rectangular region of a big file from a seekable std::istream into the memory of a tools::bitmap_view
+	///
+	/// The size of the view must be equal to the size of the region.
+	///
 	/// \throw tools::big::big_error
-	header read_header(std::istream& is);
+	template < typename ValueType >
+	void read_region(bitmap_view< ValueType > view, std::istream& is, tools::rect< std::size_t > const& region);
 
 	/// \brief Loads the data of a big file from a std::istream
 	/// First you must use the read_header-function to read the header and resize the bitmap
+	///
+	/// BitmapType must store its values contiguous without row padding.
+	///
 	/// \throw tools::big::big_error
 	template < typename BitmapType >
 	void read_data(BitmapType& bitmap, std::istream& is);
 
+	/// \brief Loads the data of a big file from a std::istream into a tools::bitmap
+	/// First you must use the read_header-function to read the header and resize the bitmap
+	/// \throw tools::big::big_error
+	template < typename ValueType, typename Layout >
+	void read_data(bitmap< ValueType, Layout >& bitmap, std::istream& is);
+
+	/// \brief Loads the data of a big file from a std::istream into the memory of a tools::bitmap_view
+	/// First you must use the read_header-function to read the header and check the size
+	/// \throw tools::big::big_error
+	template < typename ValueType >
+	void read_data(bitmap_view< ValueType > view, std::istream& is);
+
 
 	//=============================================================================
 	// Implementation
 	//=============================================================================
 
+	namespace impl{ namespace big{
+
+
+		template < typename ValueType >
+		void check_type(header const& header){
+			if(header.type != tools::big::type< ValueType >::value){
+				throw big_error("Type in file is not compatible");
+			}
+
+			// The last 4 bits in the type get the size of a single value
+			if((header.type & 0x000F) != sizeof(ValueType)){
+				throw big_error("Size type in file is not compatible");
+			}
+
+			check_sizes(header, sizeof(ValueType));
+
+			if(header.row_stride != 0 && header.row_stride < header.width * header.channels * sizeof(ValueType)){
+				throw big_error("Row stride in file is smaller than a row");
+			}
+		}
+
+		/// \brief Throws if the file contains more than a single bitmap
+		inline void check_single_bitmap(header const& header){
+			if(header.channels != 1){
+				throw big_error("Multi channel file can't be read into a bitmap");
+			}
+
+			if(header.frames != 1){
+				throw big_error("Multi frame file can't be read into a bitmap");
+			}
+		}
+
+		/// \brief Read a frame with rows that are file_row_bytes apart in the stream
+		template < typename ValueType >
+		void read_frame(bitmap_view< ValueType > view, std::istream& is, std::uint64_t file_row_bytes){
+			static_assert(!std::is_const< ValueType >::value, "Can't read into a const_bitmap_view");
+
+			auto const row_bytes = view.width() * sizeof(ValueType);
+
+			if(view.is_continuous() && file_row_bytes == row_bytes){
+				is.read(reinterpret_cast< std::ifstream::char_type* >(view.data()), row_bytes * view.height());
+			}else{
+				for(std::size_t y = 0; y < view.height(); ++y){
+					is.read(reinterpret_cast< std::ifstream::char_type* >(view.row(y)), row_bytes);
+
+					// skip the padding behind the row
+					if(y + 1 < view.height()) is.ignore(file_row_bytes - row_bytes);
+				}
+			}
+
+			if(!is.good()){
+				throw big_error("Can't read big content");
+			}
+
+			convert_undef_to_nan_in_place(view);
+		}
+
+		/// \brief Read a region of an uncompressed payload row by row
+		///
+		/// The stream must be positioned on the start of the payload.
+		template < typename ValueType >
+		void read_frame_region(
+			bitmap_view< ValueType > view, std::istream& is, header const& header, std::size_t x, std::size_t y
+		){
+			static_assert(!std::is_const< ValueType >::value, "Can't read into a const_bitmap_view");
+
+			auto const file_row_bytes = row_bytes< ValueType >(header);
+			auto const row_bytes = view.width() * sizeof(ValueType);
+
+			if(view.width() == header.width && file_row_bytes == row_bytes && view.is_continuous()){
+				// full rows are a single contiguous part of the file
+				is.seekg(static_cast< std::streamoff >(y * file_row_bytes), std::ios_base::cur);
+				is.read(reinterpret_cast< std::ifstream::char_type* >(view.data()), row_bytes * view.height());
+			}else{
+				auto const begin = is.tellg();
+
+				for(std::size_t i = 0; i < view.height(); ++i){
+					is.seekg(begin + static_cast< std::streamoff >((y + i) * file_row_bytes + x * sizeof(ValueType)));
+					is.read(reinterpret_cast< std::ifstream::char_type* >(view.row(i)), row_bytes);
+				}
+			}
+
+			if(!is.good()){
+				throw big_error("Can't read big content");
+			}
+
+			convert_undef_to_nan_in_place(view);
+		}
+
+		/// \brief Resize a tools::bitmap without initializing its values
+		template < typename ValueType, typename Layout >
+		void resize_for_read(bitmap< ValueType, Layout >& image, std::size_t width, std::size_t height){
+			image.resize(width, height, tools::uninitialized);
+		}
+
+		/// \brief Resize any other bitmap type by resize(width, height)
+		template < typename BitmapType >
+		void resize_for_read(BitmapType& image, std::size_t width, std::size_t height){
+			image.resize(width, height);
+		}
+
+		/// \brief View of a tools::bitmap, respects the row padding
+		template < typename ValueType, typename Layout >
+		bitmap_view< ValueType > view_for_read(bitmap< ValueType, Layout >& image){
+			return bitmap_view< ValueType >(image);
+		}
+
+		/// \brief View of any other bitmap type with contiguous data()
+		template < typename BitmapType >
+		bitmap_view< typename BitmapType::value_type > view_for_read(BitmapType& image){
+			using view_type = bitmap_view< typename BitmapType::value_type >;
+			return view_type(image.data(), typename view_type::size_type(image.width(), image.height()));
+		}
+
+		/// \brief Read the payload behind header, compressed or not
+		template < typename ValueType >
+		void read_payload(bitmap_view< ValueType > view, std::istream& is, header const& header){
+			if(header.placeholder & header_flags::compressed){
+				read_compressed_frame(view, is, header);
+			}else{
+				read_frame(view, is, row_bytes< ValueType >(header));
+			}
+		}
+
+
+	} }
+
+
 	template < typename BitmapType >
 	void read(BitmapType& bitmap, std::string const& filename){
 		std::ifstream is(filename.c_str(), std::ios_base::in | std::ios_base::binary);
@@ -74,52 +245,103 @@ namespace tools { namespace big {
 	void read(BitmapType& bitmap, std::istream& is){
 		header header = read_header(is);
 
-		if(header.type != big::type< typename BitmapType::value_type >::value){
-			throw big_error("Type in file is not compatible");
+		impl::big::check_type< typename BitmapType::value_type >(header);
+		impl::big::check_single_bitmap(header);
+
+		impl::big::resize_for_read(bitmap, header.width, header.height);
+
+		impl::big::read_payload(impl::big::view_for_read(bitmap), is, header);
+	}
+
+	template < typename ValueType >
+	void read(bitmap_view< ValueType > view, std::string const& filename){
+		std::ifstream is(filename.c_str(), std::ios_base::in | std::ios_base::binary);
+
+		if(!is.is_open()){
+			throw big_error("Can't open file: " + filename);
 		}
 
-		// The last 4 bits in the type get the size of a single value
-		if((header.type & 0x000F) != sizeof(typename BitmapType::value_type)){
-			throw big_error("Size type in file is not compatible");
+		try{
+			read(view, is);
+		}catch(big_error const& error){
+			throw big_error(std::string(error.what()) + ": " + filename);
 		}
+	}
 
-		bitmap.resize(header.width, header.height);
+	template < typename ValueType >
+	void read(bitmap_view< ValueType > view, std::istream& is){
+		header header = read_header(is);
 
-		read_data(bitmap, is);
-	}
+		impl::big::check_type< ValueType >(header);
+		impl::big::check_single_bitmap(header);
+
+		if(header.width != view.width() || header.height != view.height()){
+			throw big_error("Size in file is not compatible");
+		}
 
-	inline header read_header(std::istream& is){
-		header header; // big header informations
+		impl::big::read_payload(view, is, header);
+	}
 
-		// read the file header (10 Byte)
-		is.read(reinterpret_cast< std::ifstream::char_type* >(&header.width),  2);
-		is.read(reinterpret_cast< std::ifstream::char_type* >(&header.height), 2);
-		is.read(reinterpret_cast< std::ifstream::char_type* >(&header.type),   2);
-		is.read(reinterpret_cast< std::ifstream::char_type* >(&header.placeholder), 4);
+	template < typename BitmapType >
+	void read_region(BitmapType& bitmap, std::string const& filename, tools::rect< std::size_t > const& region){
+		std::ifstream is(filename.c_str(), std::ios_base::in | std::ios_base::binary);
 
-		if(!is.good()){
-			throw big_error("Can't read big header");
+		if(!is.is_open()){
+			throw big_error("Can't open file: " + filename);
 		}
 
-		return header;
+		try{
+			read_region(bitmap, is, region);
+		}catch(big_error const& error){
+			throw big_error(std::string(error.what()) + ": " + filename);
+		}
 	}
 
 	template < typename BitmapType >
-	void read_data(BitmapType& bitmap, std::istream& is){
-		is.read(
-			reinterpret_cast< std::ifstream::char_type* >(bitmap.data()),
-			bitmap.width() * bitmap.height() * sizeof(typename BitmapType::value_type)
-		);
+	void read_region(BitmapType& bitmap, std::istream& is, tools::rect< std::size_t > const& region){
+		impl::big::resize_for_read(bitmap, region.width(), region.height());
+		read_region(impl::big::view_for_read(bitmap), is, region);
+	}
 
-		if(!is.good()){
-			throw big_error("Can't read big content");
+	template < typename ValueType >
+	void read_region(bitmap_view< ValueType > view, std::istream& is, tools::rect< std::size_t > const& region){
+		header header = read_header(is);
+
+		impl::big::check_type< ValueType >(header);
+		impl::big::check_single_bitmap(header);
+
+		if(region.width() != view.width() || region.height() != view.height()){
+			throw big_error("Size of view is not compatible to region");
+		}
+
+		if(
+			region.x() > header.width || region.width() > header.width - region.x() ||
+			region.y() > header.height || region.height() > header.height - region.y()
+		){
+			throw big_error("Region is outside of the big file");
 		}
 
-		if(std::numeric_limits< typename BitmapType::value_type >::has_quiet_NaN){
-			bitmap = convert_undef_to_nan(std::move(bitmap));
+		if(header.placeholder & header_flags::compressed){
+			impl::big::read_compressed_frame(view, is, header, region.x(), region.y());
+		}else{
+			impl::big::read_frame_region(view, is, header, region.x(), region.y());
 		}
 	}
 
+	template < typename BitmapType >
+	void read_data(BitmapType& bitmap, std::istream& is){
+		read_data(impl::big::view_for_read(bitmap), is);
+	}
+
+	template < typename ValueType, typename Layout >
+	void read_data(bitmap< ValueType, Layout >& bitmap, std::istream& is){
+		read_data(bitmap_view< ValueType >(bitmap), is);
+	}
+
+	template < typename ValueType >
+	void read_data(bitmap_view< ValueType > view, std::istream& is){
+		impl::big::read_frame(view, is, view.width() * sizeof(ValueType));
+	}
 
 } }
 
@@ -0,0 +1,333 @@
+/// \file tools/big_sequence.hpp
+/// \author Benjamin Buch (benni.buch@gmail.com)
+/// \brief Multi frame big files
+///
+/// Copyright (c) 2015 Benjamin Buch (benni dot buch at gmail dot com)
+///
+/// Distributed under the Boost Software License, Version 1.0. (See accompanying
+/// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+///
+#ifndef _tools_big_sequence_hpp_INCLUDED_
+#define _tools_big_sequence_hpp_INCLUDED_
+
+#include "big_header.hpp"
+#include "big_read.hpp"
+#include "big_write.hpp"
+#include "big_mapped_read.hpp"
+#include "bitmap_sequence.hpp"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+
+namespace tools { namespace big {
+
+
+	/// \brief Saves all frames of a sequence into one big file
+	///
+	/// All frames must have the same size. The frames are stored back to back
+	/// behind the header, so frame i starts at data_offset + i * frame_bytes(header).
+	/// More than one frame requires the extended header.
+	///
+	/// \throw tools::big::big_error
+	template < typename ValueType, typename Layout >
+	void write_sequence(std::vector< bitmap< ValueType, Layout > > const& sequence, std::string const& filename);
+
+	/// \brief Writes all frames of a sequence to a std::ostream
+	/// \throw tools::big::big_error
+	template < typename ValueType, typename Layout >
+	void write_sequence(std::vector< bitmap< ValueType, Layout > > const& sequence, std::ostream& os);
+
+
+	/// \brief Random access to the frames of a multi frame big file
+	///
+	/// The file is opened once, every frame is read by a seek to its offset.
+	template < typename ValueType >
+	class sequence_reader{
+	public:
+		/// \brief Type of the data
+		using value_type = ValueType;
+
+		/// \brief Type of the frame size
+		using size_type = tools::size< std::size_t >;
+
+
+		/// \brief Opens a big file and reads its header
+		/// \throw tools::big::big_error
+		explicit sequence_reader(std::string const& filename);
+
+
+		/// \brief Get the number of frames
+		std::size_t frame_count()const{
+			return header_.frames;
+		}
+
+		/// \brief Get the size of every frame
+		size_type const size()const{
+			return size_type(header_.width, header_.height);
+		}
+
+
+		/// \brief Loads frame i
+		/// \throw tools::big::big_error
+		bitmap< value_type > read_frame(std::size_t i);
+
+		/// \brief Loads frame i into the memory of a view with the frame size
+		/// \throw tools::big::big_error
+		void read_frame(std::size_t i, bitmap_view< value_type > view);
+
+		/// \brief Loads count frames, beginning with frame first
+		/// \throw tools::big::big_error
+		bitmap_sequence< value_type > read_range(std::size_t first, std::size_t count);
+
+		/// \brief Loads all frames
+		/// \throw tools::big::big_error
+		bitmap_sequence< value_type > read_all(){
+			return read_range(0, frame_count());
+		}
+
+
+	private:
+		/// \brief Throws if frames [first, first + count) are not in the file
+		void throw_if_out_of_range(std::size_t first, std::size_t count)const;
+
+		std::string filename_;
+		std::ifstream is_;
+		header header_;
+	};
+
+
+	/// \brief Read only views to the frames of a memory mapped multi frame big file
+	template < typename ValueType >
+	class mapped_sequence{
+	public:
+		/// \brief Type of the data
+		using value_type = ValueType;
+
+		/// \brief Type of the frame size
+		using size_type = tools::size< std::size_t >;
+
+
+		/// \brief Maps a big file by a given filename
+		/// \throw tools::big::big_error
+		explicit mapped_sequence(std::string const& filename);
+
+
+		/// \brief Get the number of frames
+		std::size_t frame_count()const{
+			return header_.frames;
+		}
+
+		/// \brief Get the size of every frame
+		size_type const size()const{
+			return size_type(header_.width, header_.height);
+		}
+
+
+		/// \brief Get a view to frame i
+		/// \attention This function performs no range protection
+		mapped_bitmap< value_type > operator[](std::size_t i)const{
+			return mapped_bitmap< value_type >(file_, data_ + i * frame_bytes< value_type >(header_), size(), row_bytes< value_type >(header_));
+		}
+
+		/// \brief Get a view to frame i
+		/// \throw tools::big::big_error
+		mapped_bitmap< value_type > frame(std::size_t i)const;
+
+		/// \brief Copy all frames to a bitmap_sequence, undef is converted to NaN
+		bitmap_sequence< value_type > copy()const;
+
+
+	private:
+		std::shared_ptr< void const > file_;
+		unsigned char const* data_;
+		header header_;
+	};
+
+
+	//=============================================================================
+	// Implementation
+	//=============================================================================
+
+	template < typename ValueType, typename Layout >
+	void write_sequence(std::vector< bitmap< ValueType, Layout > > const& sequence, std::string const& filename){
+		std::ofstream os(filename.c_str(), std::ios_base::out | std::ios_base::binary);
+
+		if(!os.is_open()){
+			throw big_error("Can't open file: " + filename);
+		}
+
+		try{
+			write_sequence(sequence, os);
+		}catch(big_error const& error){
+			throw big_error(std::string(error.what()) + ": " + filename);
+		}
+	}
+
+	template < typename ValueType, typename Layout >
+	void write_sequence(std::vector< bitmap< ValueType, Layout > > const& sequence, std::ostream& os){
+		auto const width = sequence.empty() ? 0 : sequence.front().width();
+		auto const height = sequence.empty() ? 0 : sequence.front().height();
+
+		for(auto const& frame: sequence){
+			if(frame.width() != width || frame.height() != height){
+				throw big_error("Frames in sequence have different sizes");
+			}
+		}
+
+		write_header(make_header< ValueType >(width, height, 1, sequence.size()), os);
+
+		for(auto const& frame: sequence){
+			impl::big::write_frame(const_bitmap_view< ValueType >(frame), os);
+		}
+	}
+
+
+	template < typename ValueType >
+	sequence_reader< ValueType >::sequence_reader(std::string const& filename):
+		filename_(filename),
+		is_(filename.c_str(), std::ios_base::in | std::ios_base::binary)
+	{
+		if(!is_.is_open()){
+			throw big_error("Can't open file: " + filename_);
+		}
+
+		try{
+			header_ = read_header(is_);
+			impl::big::check_type< value_type >(header_);
+			impl::big::check_uncompressed(header_);
+
+			if(header_.channels != 1){
+				throw big_error("Multi channel file can't be read into a bitmap");
+			}
+		}catch(big_error const& error){
+			throw big_error(std::string(error.what()) + ": " + filename_);
+		}
+	}
+
+	template < typename ValueType >
+	bitmap< ValueType > sequence_reader< ValueType >::read_frame(std::size_t i){
+		bitmap< value_type > result(size(), tools::uninitialized);
+		read_frame(i, bitmap_view< value_type >(result));
+		return result;
+	}
+
+	template < typename ValueType >
+	void sequence_reader< ValueType >::read_frame(std::size_t i, bitmap_view< value_type > view){
+		throw_if_out_of_range(i, 1);
+
+		if(view.width() != header_.width || view.height() != header_.height){
+			throw big_error("Size of view is not compatible: " + filename_);
+		}
+
+		try{
+			is_.clear();
+			is_.seekg(header_.data_offset + i * frame_bytes< value_type >(header_));
+			impl::big::read_frame(view, is_, row_bytes< value_type >(header_));
+		}catch(big_error const& error){
+			throw big_error(std::string(error.what()) + ": " + filename_);
+		}
+	}
+
+	template < typename ValueType >
+	bitmap_sequence< ValueType > sequence_reader< ValueType >::read_range(std::size_t first, std::size_t count){
+		throw_if_out_of_range(first, count);
+
+		bitmap_sequence< value_type > result;
+		result.reserve(count);
+
+		try{
+			is_.clear();
+			is_.seekg(header_.data_offset + first * frame_bytes< value_type >(header_));
+
+			for(std::size_t i = 0; i < count; ++i){
+				result.emplace_back(size(), tools::uninitialized);
+
+				// frames are back to back, so the stream is already at the next one
+				impl::big::read_frame(bitmap_view< value_type >(result.back()), is_, row_bytes< value_type >(header_));
+
+				// read_frame stops behind the data of the last row, skip its padding
+				if(i + 1 < count){
+					is_.ignore(row_bytes< value_type >(header_) - header_.width * sizeof(value_type));
+				}
+			}
+		}catch(big_error const& error){
+			throw big_error(std::string(error.what()) + ": " + filename_);
+		}
+
+		return result;
+	}
+
+	template < typename ValueType >
+	void sequence_reader< ValueType >::throw_if_out_of_range(std::size_t first, std::size_t count)const{
+		if(first > frame_count() || count > frame_count() - first){
+			throw big_error(
+				"Frames [" + std::to_string(first) + ", " + std::to_string(first + count) +
+				") out of range, file contains " + std::to_string(frame_count()) + " frames: " + filename_
+			);
+		}
+	}
+
+
+	template < typename ValueType >
+	mapped_sequence< ValueType >::mapped_sequence(std::string const& filename){
+		std::shared_ptr< impl::big::mapped_file > file;
+
+		try{
+			file = std::make_shared< impl::big::mapped_file >(filename);
+		}catch(boost::interprocess::interprocess_exception const& error){
+			throw big_error("Can't map file (" + std::string(error.what()) + "): " + filename);
+		}
+
+		auto const data = static_cast< char const* >(file->region.get_address());
+		auto const bytes = file->region.get_size();
+
+		try{
+			header_ = impl::big::parse_header(data, bytes);
+			impl::big::check_type< value_type >(header_);
+			impl::big::check_uncompressed(header_);
+
+			if(header_.channels != 1){
+				throw big_error("Multi channel file can't be read into a bitmap");
+			}
+
+			// check_type guarantees that the product doesn't overflow
+			if(
+				bytes < header_.data_offset ||
+				bytes - header_.data_offset < header_.frames * frame_bytes< value_type >(header_)
+			){
+				throw big_error("Can't read big content");
+			}
+		}catch(big_error const& error){
+			throw big_error(std::string(error.what()) + ": " + filename);
+		}
+
+		data_ = reinterpret_cast< unsigned char const* >(data + header_.data_offset);
+		file_ = std::move(file);
+	}
+
+	template < typename ValueType >
+	mapped_bitmap< ValueType > mapped_sequence< ValueType >::frame(std::size_t i)const{
+		if(i >= frame_count()){
+			throw big_error("Frame " + std::to_string(i) + " out of range, file contains " + std::to_string(frame_count()) + " frames");
+		}
+
+		return (*this)[i];
+	}
+
+	template < typename ValueType >
+	bitmap_sequence< ValueType > mapped_sequence< ValueType >::copy()const{
+		bitmap_sequence< value_type > result(frame_count());
+
+		for(std::size_t i = 0; i < frame_count(); ++i){
+			(*this)[i].copy_to(result[i]);
+		}
+
+		return result;
+	}
+
+
+} }
+
+#endif
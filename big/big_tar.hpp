@@ -0,0 +1,55 @@
+/// \file tools/big_tar.hpp
+/// \author Benjamin Buch (benni.buch@gmail.com)
+/// \brief Access to big files inside of tar archives
+///
+/// Copyright (c) 2015 Benjamin Buch (benni dot buch at gmail dot com)
+///
+/// Distributed under the Boost Software License, Version 1.0. (See accompanying
+/// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+///
+#ifndef _tools_big_tar_hpp_INCLUDED_
+#define _tools_big_tar_hpp_INCLUDED_
+
+#include "big_exception.hpp"
+#include "big_mapped_read.hpp"
+#include "tar.hpp"
+
+#include <string>
+
+namespace tools { namespace big {
+
+
+	/// \brief View a big file entry of a memory mapped tar archive without copying
+	///
+	/// The view keeps the mapping of the archive alive.
+	///
+	/// \throw tools::big::big_error
+	template < typename ValueType >
+	mapped_bitmap< ValueType > map_tar_entry(mapped_tar_reader const& tar, std::string const& filename);
+
+
+	//=============================================================================
+	// Implementation
+	//=============================================================================
+
+	template < typename ValueType >
+	mapped_bitmap< ValueType > map_tar_entry(mapped_tar_reader const& tar, std::string const& filename){
+		boost::string_view content;
+
+		try{
+			content = tar.get(filename);
+		}catch(std::runtime_error const& error){
+			throw big_error(error.what());
+		}
+
+		try{
+			return mapped_bitmap< ValueType >(tar.mapping(), content.data(), content.size());
+		}catch(big_error const& error){
+			throw big_error(std::string(error.what()) + ": " + filename);
+		}
+	}
+
+
+} }
+
+#endif
@@ -11,16 +11,30 @@
 #ifndef _undef_conversion_hpp_INCLUDED_
 #define _undef_conversion_hpp_INCLUDED_
 
+#include "bitmap_view.hpp"
+
 #include <cmath>
 #include <limits>
 #include <algorithm>
 #include <utility>
+#include <type_traits>
 
 
 #if defined(_MSC_VER) && _MSC_VER <= 1800
 #define constexpr const
 #endif
 
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define TOOLS_BIG_UNDEF_CONVERSION_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TOOLS_BIG_TARGET(name)
+#else
+#define TOOLS_BIG_TARGET(name) __attribute__((target(name)))
+#endif
+#endif
+
 
 namespace tools { namespace big {
 
@@ -32,13 +46,270 @@ namespace tools { namespace big {
 
 	constexpr float undef = 3.402823466e38f;
 
+
+	namespace impl{ namespace big{
+
+
+		template < typename T >
+		inline T undef_to_nan(T value, std::true_type){
+			return value >= undef ? std::numeric_limits< T >::quiet_NaN() : value;
+		}
+
+		template < typename T >
+		inline T undef_to_nan(T value, std::false_type){
+			return value;
+		}
+
+		/// \brief Convert a single value, types without NaN are returned unchanged
+		template < typename T >
+		inline T undef_to_nan(T value){
+			return undef_to_nan(value, std::integral_constant< bool, std::numeric_limits< T >::has_quiet_NaN >());
+		}
+
+		template < typename T >
+		inline T nan_to_undef(T value, std::true_type){
+			return isnan(value) ? undef : value;
+		}
+
+		template < typename T >
+		inline T nan_to_undef(T value, std::false_type){
+			return value;
+		}
+
+		/// \brief Convert a single value, types without NaN are returned unchanged
+		template < typename T >
+		inline T nan_to_undef(T value){
+			return nan_to_undef(value, std::integral_constant< bool, std::numeric_limits< T >::has_quiet_NaN >());
+		}
+
+
+		/// \brief Instruction sets for the conversion kernels
+		enum class simd_level{
+			scalar,
+			sse2,
+			avx2
+		};
+
+		/// \brief Get the best instruction set of the executing CPU, detected once
+		inline simd_level detect_simd_level(){
+			static simd_level const level = []{
+#ifdef TOOLS_BIG_UNDEF_CONVERSION_X86
+#ifdef _MSC_VER
+				int info[4];
+				__cpuid(info, 0);
+				int const max_id = info[0];
+
+				__cpuid(info, 1);
+				bool const sse2 = (info[3] & (1 << 26)) != 0;
+				bool const os_avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+
+				bool avx2 = false;
+				if(os_avx && max_id >= 7){
+					__cpuidex(info, 7, 0);
+					avx2 = (info[1] & (1 << 5)) != 0;
+				}
+#else
+				__builtin_cpu_init();
+				bool const sse2 = __builtin_cpu_supports("sse2") != 0;
+				bool const avx2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+				if(avx2) return simd_level::avx2;
+				if(sse2) return simd_level::sse2;
+#endif
+				return simd_level::scalar;
+			}();
+
+			return level;
+		}
+
+
+		template < typename T >
+		inline void undef_to_nan_scalar(T const* in, T* out, std::size_t count){
+			for(std::size_t i = 0; i < count; ++i) out[i] = undef_to_nan(in[i]);
+		}
+
+		template < typename T >
+		inline void nan_to_undef_scalar(T const* in, T* out, std::size_t count){
+			for(std::size_t i = 0; i < count; ++i) out[i] = nan_to_undef(in[i]);
+		}
+
+
+#ifdef TOOLS_BIG_UNDEF_CONVERSION_X86
+		TOOLS_BIG_TARGET("sse2")
+		inline void undef_to_nan_sse2(float const* in, float* out, std::size_t count){
+			__m128 const limit = _mm_set1_ps(undef);
+			__m128 const nan = _mm_set1_ps(std::numeric_limits< float >::quiet_NaN());
+
+			std::size_t i = 0;
+			for(; i + 4 <= count; i += 4){
+				__m128 const value = _mm_loadu_ps(in + i);
+				__m128 const mask = _mm_cmpge_ps(value, limit);
+				_mm_storeu_ps(out + i, _mm_or_ps(_mm_and_ps(mask, nan), _mm_andnot_ps(mask, value)));
+			}
+
+			undef_to_nan_scalar(in + i, out + i, count - i);
+		}
+
+		TOOLS_BIG_TARGET("sse2")
+		inline void undef_to_nan_sse2(double const* in, double* out, std::size_t count){
+			__m128d const limit = _mm_set1_pd(undef);
+			__m128d const nan = _mm_set1_pd(std::numeric_limits< double >::quiet_NaN());
+
+			std::size_t i = 0;
+			for(; i + 2 <= count; i += 2){
+				__m128d const value = _mm_loadu_pd(in + i);
+				__m128d const mask = _mm_cmpge_pd(value, limit);
+				_mm_storeu_pd(out + i, _mm_or_pd(_mm_and_pd(mask, nan), _mm_andnot_pd(mask, value)));
+			}
+
+			undef_to_nan_scalar(in + i, out + i, count - i);
+		}
+
+		TOOLS_BIG_TARGET("sse2")
+		inline void nan_to_undef_sse2(float const* in, float* out, std::size_t count){
+			__m128 const limit = _mm_set1_ps(undef);
+
+			std::size_t i = 0;
+			for(; i + 4 <= count; i += 4){
+				__m128 const value = _mm_loadu_ps(in + i);
+				__m128 const mask = _mm_cmpunord_ps(value, value);
+				_mm_storeu_ps(out + i, _mm_or_ps(_mm_and_ps(mask, limit), _mm_andnot_ps(mask, value)));
+			}
+
+			nan_to_undef_scalar(in + i, out + i, count - i);
+		}
+
+		TOOLS_BIG_TARGET("sse2")
+		inline void nan_to_undef_sse2(double const* in, double* out, std::size_t count){
+			__m128d const limit = _mm_set1_pd(undef);
+
+			std::size_t i = 0;
+			for(; i + 2 <= count; i += 2){
+				__m128d const value = _mm_loadu_pd(in + i);
+				__m128d const mask = _mm_cmpunord_pd(value, value);
+				_mm_storeu_pd(out + i, _mm_or_pd(_mm_and_pd(mask, limit), _mm_andnot_pd(mask, value)));
+			}
+
+			nan_to_undef_scalar(in + i, out + i, count - i);
+		}
+
+		TOOLS_BIG_TARGET("avx2")
+		inline void undef_to_nan_avx2(float const* in, float* out, std::size_t count){
+			__m256 const limit = _mm256_set1_ps(undef);
+			__m256 const nan = _mm256_set1_ps(std::numeric_limits< float >::quiet_NaN());
+
+			std::size_t i = 0;
+			for(; i + 8 <= count; i += 8){
+				__m256 const value = _mm256_loadu_ps(in + i);
+				__m256 const mask = _mm256_cmp_ps(value, limit, _CMP_GE_OQ);
+				_mm256_storeu_ps(out + i, _mm256_blendv_ps(value, nan, mask));
+			}
+
+			undef_to_nan_scalar(in + i, out + i, count - i);
+		}
+
+		TOOLS_BIG_TARGET("avx2")
+		inline void undef_to_nan_avx2(double const* in, double* out, std::size_t count){
+			__m256d const limit = _mm256_set1_pd(undef);
+			__m256d const nan = _mm256_set1_pd(std::numeric_limits< double >::quiet_NaN());
+
+			std::size_t i = 0;
+			for(; i + 4 <= count; i += 4){
+				__m256d const value = _mm256_loadu_pd(in + i);
+				__m256d const mask = _mm256_cmp_pd(value, limit, _CMP_GE_OQ);
+				_mm256_storeu_pd(out + i, _mm256_blendv_pd(value, nan, mask));
+			}
+
+			undef_to_nan_scalar(in + i, out + i, count - i);
+		}
+
+		TOOLS_BIG_TARGET("avx2")
+		inline void nan_to_undef_avx2(float const* in, float* out, std::size_t count){
+			__m256 const limit = _mm256_set1_ps(undef);
+
+			std::size_t i = 0;
+			for(; i + 8 <= count; i += 8){
+				__m256 const value = _mm256_loadu_ps(in + i);
+				__m256 const mask = _mm256_cmp_ps(value, value, _CMP_UNORD_Q);
+				_mm256_storeu_ps(out + i, _mm256_blendv_ps(value, limit, mask));
+			}
+
+			nan_to_undef_scalar(in + i, out + i, count - i);
+		}
+
+		TOOLS_BIG_TARGET("avx2")
+		inline void nan_to_undef_avx2(double const* in, double* out, std::size_t count){
+			__m256d const limit = _mm256_set1_pd(undef);
+
+			std::size_t i = 0;
+			for(; i + 4 <= count; i += 4){
+				__m256d const value = _mm256_loadu_pd(in + i);
+				__m256d const mask = _mm256_cmp_pd(value, value, _CMP_UNORD_Q);
+				_mm256_storeu_pd(out + i, _mm256_blendv_pd(value, limit, mask));
+			}
+
+			nan_to_undef_scalar(in + i, out + i, count - i);
+		}
+#endif
+
+
+		/// \brief Convert count values from in to out, in and out may be equal
+		template < typename T >
+		inline void undef_to_nan(T const* in, T* out, std::size_t count){
+			undef_to_nan_scalar(in, out, count);
+		}
+
+		/// \brief Convert count values from in to out, in and out may be equal
+		template < typename T >
+		inline void nan_to_undef(T const* in, T* out, std::size_t count){
+			nan_to_undef_scalar(in, out, count);
+		}
+
+#ifdef TOOLS_BIG_UNDEF_CONVERSION_X86
+		inline void undef_to_nan(float const* in, float* out, std::size_t count){
+			switch(detect_simd_level()){
+				case simd_level::avx2: undef_to_nan_avx2(in, out, count); return;
+				case simd_level::sse2: undef_to_nan_sse2(in, out, count); return;
+				default: undef_to_nan_scalar(in, out, count);
+			}
+		}
+
+		inline void undef_to_nan(double const* in, double* out, std::size_t count){
+			switch(detect_simd_level()){
+				case simd_level::avx2: undef_to_nan_avx2(in, out, count); return;
+				case simd_level::sse2: undef_to_nan_sse2(in, out, count); return;
+				default: undef_to_nan_scalar(in, out, count);
+			}
+		}
+
+		inline void nan_to_undef(float const* in, float* out, std::size_t count){
+			switch(detect_simd_level()){
+				case simd_level::avx2: nan_to_undef_avx2(in, out, count); return;
+				case simd_level::sse2: nan_to_undef_sse2(in, out, count); return;
+				default: nan_to_undef_scalar(in, out, count);
+			}
+		}
+
+		inline void nan_to_undef(double const* in, double* out, std::size_t count){
+			switch(detect_simd_level()){
+				case simd_level::avx2: nan_to_undef_avx2(in, out, count); return;
+				case simd_level::sse2: nan_to_undef_sse2(in, out, count); return;
+				default: nan_to_undef_scalar(in, out, count);
+			}
+		}
+#endif
+
+
+	} }
+
+
 	template < typename container >
 	container convert_undef_to_nan(container const& image){
 		typedef typename container::value_type value_type;
 
 		container result(image.size());
 		std::transform(image.begin(), image.end(), result.begin(), [](value_type value){
-			return value >= undef ? std::numeric_limits< value_type >::quiet_NaN() : value;
+			return impl::big::undef_to_nan(value);
 		});
 
 		return std::move(result);
@@ -50,13 +321,92 @@ namespace tools { namespace big {
 
 		container result(image.size());
 		std::transform(image.begin(), image.end(), result.begin(), [](value_type value){
-			return isnan(value) ? undef : value;
+			return impl::big::nan_to_undef(value);
 		});
 
 		return std::move(result);
 	}
 
+	/// \brief Convert all undef values to NaN, bitmaps use the SIMD kernel
+	template < typename ValueType, typename Layout >
+	bitmap< ValueType, Layout > convert_undef_to_nan(bitmap< ValueType, Layout > const& image){
+		bitmap< ValueType, Layout > result(image.size(), tools::uninitialized);
+		if(image.row_stride() == image.width()){
+			impl::big::undef_to_nan(image.data(), result.data(), image.point_count());
+		}else{
+			for(std::size_t y = 0; y < image.height(); ++y){
+				impl::big::undef_to_nan(image.row(y), result.row(y), image.width());
+			}
+		}
+		return result;
+	}
+
+	/// \brief Convert all NaN values to undef, bitmaps use the SIMD kernel
+	template < typename ValueType, typename Layout >
+	bitmap< ValueType, Layout > convert_nan_to_undef(bitmap< ValueType, Layout > const& image){
+		bitmap< ValueType, Layout > result(image.size(), tools::uninitialized);
+		if(image.row_stride() == image.width()){
+			impl::big::nan_to_undef(image.data(), result.data(), image.point_count());
+		}else{
+			for(std::size_t y = 0; y < image.height(); ++y){
+				impl::big::nan_to_undef(image.row(y), result.row(y), image.width());
+			}
+		}
+		return result;
+	}
+
+
+	/// \brief Convert all undef values in the view to NaN
+	template < typename ValueType >
+	void convert_undef_to_nan_in_place(bitmap_view< ValueType > view){
+		static_assert(!std::is_const< ValueType >::value, "Can't convert a const_bitmap_view");
+
+		if(!std::numeric_limits< ValueType >::has_quiet_NaN) return;
+
+		if(view.is_continuous()){
+			impl::big::undef_to_nan(view.data(), view.data(), view.point_count());
+		}else{
+			for(std::size_t y = 0; y < view.height(); ++y){
+				impl::big::undef_to_nan(view.row(y), view.row(y), view.width());
+			}
+		}
+	}
+
+	/// \brief Convert all undef values in the bitmap to NaN
+	template < typename ValueType, typename Layout >
+	void convert_undef_to_nan_in_place(bitmap< ValueType, Layout >& image){
+		convert_undef_to_nan_in_place(bitmap_view< ValueType >(image));
+	}
+
+	/// \brief Convert all NaN values in the view to undef
+	template < typename ValueType >
+	void convert_nan_to_undef_in_place(bitmap_view< ValueType > view){
+		static_assert(!std::is_const< ValueType >::value, "Can't convert a const_bitmap_view");
+
+		if(!std::numeric_limits< ValueType >::has_quiet_NaN) return;
+
+		if(view.is_continuous()){
+			impl::big::nan_to_undef(view.data(), view.data(), view.point_count());
+		}else{
+			for(std::size_t y = 0; y < view.height(); ++y){
+				impl::big::nan_to_undef(view.row(y), view.row(y), view.width());
+			}
+		}
+	}
+
+	/// \brief Convert all NaN values in the bitmap to undef
+	template < typename ValueType, typename Layout >
+	void convert_nan_to_undef_in_place(bitmap< ValueType, Layout >& image){
+		convert_nan_to_undef_in_place(bitmap_view< ValueType >(image));
+	}
+
 
 } }
 
+
+#ifdef TOOLS_BIG_UNDEF_CONVERSION_X86
+#undef TOOLS_BIG_UNDEF_CONVERSION_X86
+#undef TOOLS_BIG_TARGET
+#endif
+
 #endif
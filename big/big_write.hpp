@@ -12,10 +12,15 @@
 #define _tools_big_write_hpp_INCLUDED_
 
 #include "big_types.hpp"
+#include "big_header.hpp"
 #include "big_exception.hpp"
+#include "big_compression.hpp"
 #include "big_undef_conversion.hpp"
+#include "bitmap_view.hpp"
 
 #include <string>
+#include <memory>
+#include <algorithm>
 #include <fstream>
 #include <cstdint>
 
@@ -32,11 +37,90 @@ namespace tools { namespace big {
 	template < typename BitmapType >
 	void write(BitmapType const& bitmap, std::ostream& os);
 
+	/// \brief Writes the region of a tools::bitmap_view to a std::ostream
+	/// \throw tools::big::big_error
+	template < typename ValueType >
+	void write(bitmap_view< ValueType > view, std::ostream& os);
+
+	/// \brief Saves a bitmap with compressed payload by a given filename
+	/// \throw tools::big::big_error
+	template < typename BitmapType >
+	void write(BitmapType const& bitmap, std::string const& filename, compression const& compression);
+
+	/// \brief Writes a bitmap with compressed payload to a std::ostream
+	/// \throw tools::big::big_error
+	template < typename BitmapType >
+	void write(BitmapType const& bitmap, std::ostream& os, compression const& compression);
+
+	/// \brief Writes the region of a tools::bitmap_view with compressed payload to a std::ostream
+	/// \throw tools::big::big_error
+	template < typename ValueType >
+	void write(bitmap_view< ValueType > view, std::ostream& os, compression const& compression);
+
 
 	//=============================================================================
 	// Implementation
 	//=============================================================================
 
+	namespace impl{ namespace big{
+
+
+		/// \brief Size of the buffer for NaN to undef conversion while writing
+		constexpr std::size_t write_chunk_bytes = 64 * 1024;
+
+
+		/// \brief Write the data of a view without header and without NaN to undef conversion
+		template < typename ValueType >
+		void write_raw_frame(bitmap_view< ValueType > view, std::ostream& os){
+			using value_type = typename bitmap_view< ValueType >::value_type;
+
+			auto const row_bytes = view.width() * sizeof(value_type);
+
+			if(view.is_continuous()){
+				os.write(reinterpret_cast< std::ifstream::char_type const* >(view.data()), row_bytes * view.height());
+			}else{
+				for(std::size_t y = 0; y < view.height(); ++y){
+					os.write(reinterpret_cast< std::ifstream::char_type const* >(view.row(y)), row_bytes);
+				}
+			}
+
+			if(!os.good()){
+				throw big_error("Can't write big content");
+			}
+		}
+
+		/// \brief Write the data of a view without header
+		template < typename ValueType >
+		void write_frame(bitmap_view< ValueType > view, std::ostream& os){
+			using value_type = typename bitmap_view< ValueType >::value_type;
+
+			if(!std::numeric_limits< value_type >::has_quiet_NaN){
+				write_raw_frame(view, os);
+				return;
+			}
+
+			// convert chunk by chunk into a small buffer
+			std::size_t const chunk_size = std::max< std::size_t >(1, write_chunk_bytes / sizeof(value_type));
+			std::unique_ptr< value_type[] > buffer(new value_type[chunk_size]);
+
+			for(std::size_t y = 0; y < view.height(); ++y){
+				for(std::size_t x = 0; x < view.width(); x += chunk_size){
+					auto const count = std::min(chunk_size, view.width() - x);
+
+					nan_to_undef(view.row(y) + x, buffer.get(), count);
+					os.write(reinterpret_cast< std::ifstream::char_type const* >(buffer.get()), count * sizeof(value_type));
+				}
+			}
+
+			if(!os.good()){
+				throw big_error("Can't write big content");
+			}
+		}
+
+
+	} }
+
+
 	template < typename BitmapType >
 	void write(BitmapType const& bitmap, std::string const& filename){
 		std::ofstream os(filename.c_str(), std::ios_base::out | std::ios_base::binary);
@@ -54,38 +138,47 @@ namespace tools { namespace big {
 
 	template < typename BitmapType >
 	void write(BitmapType const& bitmap, std::ostream& os){
-		// big header informations
-		std::uint16_t width  = static_cast< std::uint16_t >(bitmap.width());
-		std::uint16_t height = static_cast< std::uint16_t >(bitmap.height());
-		std::uint16_t type   = big::type< typename BitmapType::value_type >::value;
-		std::uint32_t placeholder = 0; // 4 bytes in header are reserved
-
-		// write the file header
-		os.write(reinterpret_cast< std::istream::char_type const* >(&width),  2);
-		os.write(reinterpret_cast< std::istream::char_type const* >(&height), 2);
-		os.write(reinterpret_cast< std::istream::char_type const* >(&type),   2);
-		os.write(reinterpret_cast< std::istream::char_type const* >(&placeholder), 4);
-
-		if(!os.good()){
-			throw big_error("Can't write big header");
-		}
+		write(const_bitmap_view< typename BitmapType::value_type >(bitmap), os);
+	}
+
+	template < typename ValueType >
+	void write(bitmap_view< ValueType > view, std::ostream& os){
+		using value_type = typename bitmap_view< ValueType >::value_type;
+
+		write_header(make_header< value_type >(view.width(), view.height()), os);
+		impl::big::write_frame(view, os);
+	}
 
-		auto bytes = bitmap.width() * bitmap.height() * sizeof(typename BitmapType::value_type);
+	template < typename BitmapType >
+	void write(BitmapType const& bitmap, std::string const& filename, compression const& compression){
+		std::ofstream os(filename.c_str(), std::ios_base::out | std::ios_base::binary);
 
-		os.write(
-			reinterpret_cast< std::ifstream::char_type const* >(
-				std::numeric_limits< typename BitmapType::value_type >::has_quiet_NaN ?
-				convert_nan_to_undef(bitmap).data() :
-				bitmap.data()
-			),
-			bytes
-		);
+		if(!os.is_open()){
+			throw big_error("Can't open file: " + filename);
+		}
 
-		if(!os.good()){
-			throw big_error("Can't write big content");
+		try{
+			write(bitmap, os, compression);
+		}catch(big_error const& error){
+			throw big_error(std::string(error.what()) + ": " + filename);
 		}
 	}
 
+	template < typename BitmapType >
+	void write(BitmapType const& bitmap, std::ostream& os, compression const& compression){
+		write(const_bitmap_view< typename BitmapType::value_type >(bitmap), os, compression);
+	}
+
+	template < typename ValueType >
+	void write(bitmap_view< ValueType > view, std::ostream& os, compression const& compression){
+		using value_type = typename bitmap_view< ValueType >::value_type;
+
+		auto header = make_header< value_type >(view.width(), view.height());
+		impl::big::set_compression< value_type >(header, compression);
+
+		write_header(header, os);
+		impl::big::write_compressed_frame(view, header, os);
+	}
 
 } }
 
@@ -0,0 +1 @@
+big/big_any_read.hpp
\ No newline at end of file
@@ -0,0 +1 @@
+big/big_async_read.hpp
\ No newline at end of file
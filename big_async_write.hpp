@@ -0,0 +1 @@
+big/big_async_write.hpp
\ No newline at end of file
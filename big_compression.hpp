@@ -0,0 +1 @@
+big/big_compression.hpp
\ No newline at end of file
@@ -0,0 +1 @@
+big/big_header.hpp
\ No newline at end of file
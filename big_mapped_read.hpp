@@ -0,0 +1 @@
+big/big_mapped_read.hpp
\ No newline at end of file
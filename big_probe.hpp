@@ -0,0 +1 @@
+big/big_probe.hpp
\ No newline at end of file
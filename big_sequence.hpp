@@ -0,0 +1 @@
+big/big_sequence.hpp
\ No newline at end of file
@@ -0,0 +1 @@
+big/big_tar.hpp
\ No newline at end of file
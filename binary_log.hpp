@@ -0,0 +1 @@
+log/binary_log.hpp
\ No newline at end of file
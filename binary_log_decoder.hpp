@@ -0,0 +1 @@
+log/binary_log_decoder.hpp
\ No newline at end of file
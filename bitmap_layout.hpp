@@ -0,0 +1 @@
+data_2d/bitmap_layout.hpp
\ No newline at end of file
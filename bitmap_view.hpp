@@ -0,0 +1 @@
+data_2d/bitmap_view.hpp
\ No newline at end of file
@@ -0,0 +1 @@
+container_formats/concurrent_tar_writer.hpp
\ No newline at end of file
@@ -0,0 +1,212 @@
+/// \file tools/concurrent_tar_writer.hpp
+/// \author Benjamin Buch (benni.buch@gmail.com)
+/// \brief class tools::concurrent_tar_writer
+///
+/// Copyright (c) 2015 Benjamin Buch (benni dot buch at gmail dot com)
+///
+/// Distributed under the Boost Software License, Version 1.0. (See accompanying
+/// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+///
+#ifndef _tools_concurrent_tar_writer_hpp_INCLUDED_
+#define _tools_concurrent_tar_writer_hpp_INCLUDED_
+
+#include "tar.hpp"
+
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <future>
+#include <memory>
+#include <functional>
+#include <exception>
+#include <condition_variable>
+
+
+namespace tools {
+
+
+	/// \brief Write a tar file with entries from many threads
+	///
+	/// All member functions are thread safe. The entries are queued and
+	/// written in submission order by a single writer thread, so the archive
+	/// is the same as if one thread had written them with a tar_writer.
+	///
+	/// The future of an entry throws if it can't be written, for example
+	/// because of a duplicate filename.
+	class concurrent_tar_writer{
+	public:
+		/// \brief Create a tar file or append to an existing one
+		///
+		/// \param filename The tar file
+		/// \param append Append to an existing archive, see tar_writer
+		/// \param queue_size Maximal count of entries waiting for the writer thread
+		///
+		/// \throw std::runtime_error if the existing archive is corrupt
+		explicit concurrent_tar_writer(std::string const& filename, bool append = false, std::size_t queue_size = 16);
+
+		/// \brief Write to a stream, which must stay valid for the lifetime of the writer
+		explicit concurrent_tar_writer(std::ostream& out, std::size_t queue_size = 16);
+
+		concurrent_tar_writer(concurrent_tar_writer const&) = delete;
+		concurrent_tar_writer& operator=(concurrent_tar_writer const&) = delete;
+
+		/// \brief Writes all queued entries and the end marker
+		~concurrent_tar_writer();
+
+
+		/// \brief Queue an entry, blocks while the queue is full
+		std::future< void > write(std::string filename, std::string content);
+
+		/// \brief Queue an entry with a size known before
+		///
+		/// The writer is called on the writer thread, see tar_writer.
+		std::future< void > write(std::string filename, std::size_t size, std::function< void(std::ostream&) > writer);
+
+		/// \brief Queue an entry with a size that is unknown before
+		///
+		/// The writer is called on the writer thread, see tar_writer.
+		std::future< void > write(std::string filename, std::function< void(std::ostream&) > writer);
+
+		/// \brief Waits until all queued entries are written
+		void flush();
+
+
+	private:
+		/// \brief An entry waiting for the writer thread
+		struct job{
+			std::function< void(tar_writer&) > write;
+			std::promise< void > promise;
+		};
+
+		/// \brief Queue a job, blocks while the queue is full
+		std::future< void > push(std::function< void(tar_writer&) >&& write);
+
+		/// \brief Loop of the writer thread
+		void run();
+
+		std::unique_ptr< tar_writer > writer_;
+
+		std::size_t const queue_size_;
+
+		std::mutex mutex_;
+		std::condition_variable not_empty_;
+		std::condition_variable not_full_;
+		std::condition_variable idle_;
+
+		std::deque< job > queue_;
+
+		/// \brief true while the writer thread processes a job outside of the queue
+		bool busy_ = false;
+
+		/// \brief Set by the destructor
+		bool stop_ = false;
+
+		std::thread thread_;
+	};
+
+
+	//=============================================================================
+	// Implementation
+	//=============================================================================
+
+
+	inline concurrent_tar_writer::concurrent_tar_writer(std::string const& filename, bool append, std::size_t queue_size):
+		writer_(new tar_writer(filename, append)),
+		queue_size_(queue_size > 0 ? queue_size : 1),
+		thread_([this]{ run(); })
+		{}
+
+	inline concurrent_tar_writer::concurrent_tar_writer(std::ostream& out, std::size_t queue_size):
+		writer_(new tar_writer(out)),
+		queue_size_(queue_size > 0 ? queue_size : 1),
+		thread_([this]{ run(); })
+		{}
+
+	inline concurrent_tar_writer::~concurrent_tar_writer(){
+		{
+			std::lock_guard< std::mutex > lock(mutex_);
+			stop_ = true;
+		}
+		not_empty_.notify_one();
+
+		thread_.join();
+	}
+
+	inline std::future< void > concurrent_tar_writer::write(std::string filename, std::string content){
+		return push([filename = std::move(filename), content = std::move(content)](tar_writer& writer){
+			writer.write(filename, content);
+		});
+	}
+
+	inline std::future< void > concurrent_tar_writer::write(
+		std::string filename, std::size_t size, std::function< void(std::ostream&) > writer
+	){
+		return push([filename = std::move(filename), size, writer = std::move(writer)](tar_writer& tar){
+			tar.write(filename, size, writer);
+		});
+	}
+
+	inline std::future< void > concurrent_tar_writer::write(
+		std::string filename, std::function< void(std::ostream&) > writer
+	){
+		return push([filename = std::move(filename), writer = std::move(writer)](tar_writer& tar){
+			tar.write(filename, writer);
+		});
+	}
+
+	inline void concurrent_tar_writer::flush(){
+		std::unique_lock< std::mutex > lock(mutex_);
+		idle_.wait(lock, [this]{ return queue_.empty() && !busy_; });
+	}
+
+	inline std::future< void > concurrent_tar_writer::push(std::function< void(tar_writer&) >&& write){
+		std::promise< void > promise;
+		auto future = promise.get_future();
+
+		{
+			std::unique_lock< std::mutex > lock(mutex_);
+			not_full_.wait(lock, [this]{ return queue_.size() < queue_size_; });
+			queue_.push_back(job{std::move(write), std::move(promise)});
+		}
+		not_empty_.notify_one();
+
+		return future;
+	}
+
+	inline void concurrent_tar_writer::run(){
+		for(;;){
+			std::unique_lock< std::mutex > lock(mutex_);
+
+			if(queue_.empty()){
+				busy_ = false;
+				idle_.notify_all();
+
+				not_empty_.wait(lock, [this]{ return !queue_.empty() || stop_; });
+				if(queue_.empty()) break;
+			}
+
+			job current = std::move(queue_.front());
+			queue_.pop_front();
+			busy_ = true;
+
+			lock.unlock();
+			not_full_.notify_one();
+
+			try{
+				current.write(*writer_);
+				current.promise.set_value();
+			}catch(...){
+				current.promise.set_exception(std::current_exception());
+			}
+		}
+
+		// write the end marker
+		writer_.reset();
+	}
+
+
+}
+
+
+#endif
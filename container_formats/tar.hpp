@@ -13,9 +13,14 @@
 #include "make_string.hpp"
 #include "string_to.hpp"
 
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/utility/string_view.hpp>
+
 #include <functional>
+#include <algorithm>
+#include <streambuf>
 #include <iostream>
-#include <iomanip>
 #include <fstream>
 #include <sstream>
 #include <utility>
@@ -23,6 +28,10 @@
 #include <vector>
 #include <memory>
 #include <array>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <ctime>
 #include <tuple>
 #include <map>
 #include <set>
@@ -128,88 +137,676 @@ namespace tools {
 			return std::string(buffer.begin() + start, buffer.begin() + start + size);
 		}
 
-		constexpr std::array< char, field_size< field_name::checksum >::value > empty_checksum{{' ', ' ', ' ', ' ', ' ', ' ', ' ', ' '}};
+		/// \brief Get a header field without copying it
+		template < index_t FieldName >
+		boost::string_view read_view(std::array< char, 512 > const& buffer){
+			static constexpr auto start = field_start< FieldName >::value;
+			static constexpr auto size  = field_size< FieldName >::value;
+
+			return boost::string_view(buffer.data() + start, size);
+		}
 
 		constexpr std::array< char, 5 > magic{{'u', 's', 't', 'a', 'r'}};
 		constexpr std::array< char, 6 > mode{{'0', '0', '0', '6', '4', '4'}};
 		constexpr std::array< char, 1 > typeflag{{'0'}};
 
-		inline std::string calc_checksum(std::array< char, 512 > buffer){
-			write< field_name::checksum >(buffer, empty_checksum);
-
-			unsigned sum = 0;
-			for(unsigned i: buffer) sum += i;
+		/// \brief Write value as octal number with digits digits
+		inline void write_octal_digits(char* target, std::size_t digits, std::uint64_t value){
+			for(auto i = digits; i > 0; --i, value >>= 3){
+				target[i - 1] = static_cast< char >('0' + (value & 7));
+			}
+		}
 
-			std::ostringstream os;
-			os << std::oct << std::setfill('0') << std::setw(6) << sum << '\0' << ' ';
+		/// \brief Write value as octal number with leading zeros and a terminating null
+		template < index_t FieldName >
+		void write_octal(std::array< char, 512 >& buffer, std::uint64_t value){
+			static constexpr auto start = field_start< FieldName >::value;
+			static constexpr auto size  = field_size< FieldName >::value;
 
-			return os.str();
+			write_octal_digits(buffer.data() + start, size - 1, value);
+			buffer[start + size - 1] = '\0';
 		}
 
-		inline std::array< char, 512 > make_posix_header(std::string const& name, std::size_t size){
-			std::array< char, 512 > buffer{};
+		/// \brief Sum of all unsigned bytes, with the checksum field counted as spaces
+		inline std::uint32_t checksum_sum(std::array< char, 512 > const& buffer){
+			static constexpr auto start = field_start< field_name::checksum >::value;
+			static constexpr auto size  = field_size< field_name::checksum >::value;
+			static constexpr std::uint64_t even_bytes = 0x00FF00FF00FF00FF;
+
+			// add 8 bytes at once in four 16 bit lanes, they can't overflow in 512 bytes
+			std::uint64_t lanes = 0;
+			for(std::size_t i = 0; i < buffer.size(); i += 8){
+				std::uint64_t word;
+				std::memcpy(&word, buffer.data() + i, 8);
+				lanes += (word & even_bytes) + ((word >> 8) & even_bytes);
+			}
 
-			std::ostringstream os;
-			os << std::oct << std::setfill('0') << std::setw(11) << std::time(nullptr);
-			std::string mtime = os.str();
+			lanes = (lanes & 0x0000FFFF0000FFFF) + ((lanes >> 16) & 0x0000FFFF0000FFFF);
+			auto sum = static_cast< std::uint32_t >((lanes & 0xFFFFFFFF) + (lanes >> 32));
 
-			write< field_name::magic >(buffer, magic);
-			write< field_name::mode >(buffer, mode);
-			write< field_name::mtime >(buffer, mtime);
-			write< field_name::typeflag >(buffer, typeflag);
+			for(auto i = start; i < start + size; ++i){
+				sum -= static_cast< unsigned char >(buffer[i]);
+			}
 
+			return sum + size * ' ';
+		}
 
-			// Set filename
-			if(name.size() == 0) throw std::runtime_error("Tar: filename is empty");
-			if(name.size() >= 100) throw std::runtime_error("Tar: filename larger than 99 charakters");
+		/// \brief Set the checksum field of a header
+		inline void write_checksum(std::array< char, 512 >& buffer){
+			static constexpr auto start = field_start< field_name::checksum >::value;
 
-			write< field_name::name >(buffer, name);
+			write_octal_digits(buffer.data() + start, 6, checksum_sum(buffer));
+			buffer[start + 6] = '\0';
+			buffer[start + 7] = ' ';
+		}
 
+		/// \brief Get the count of bytes of an entry including the padding to a full record
+		/// \throw std::runtime_error if the result doesn't fit into 64 bit
+		inline std::uint64_t record_bytes(std::uint64_t size){
+			if(size > std::numeric_limits< std::uint64_t >::max() - 511){
+				throw std::runtime_error("Tar: entry size too large");
+			}
 
-			// Set size
-			os.str("");
-			os << std::oct << std::setfill('0') << std::setw(11) << size;
-			write< field_name::size >(buffer, os.str());
+			return (size + 511) / 512 * 512;
+		}
+
+		/// \brief Largest size that fits as octal number into the size field
+		constexpr std::uint64_t max_octal_size = 077777777777;
 
+		/// \brief Find the split of a filename into the ustar fields prefix and name
+		///
+		/// \return 0 if the filename fits into the name field, the position of
+		///         the '/' between prefix and name, or std::string::npos if
+		///         the filename doesn't fit into the ustar fields
+		inline std::size_t split_name(boost::string_view filename){
+			static constexpr auto name_size = field_size< field_name::name >::value;
+			static constexpr auto prefix_size = field_size< field_name::prefix >::value;
 
-			// Set checksum
-			write< field_name::checksum >(buffer, calc_checksum(buffer));
+			if(filename.size() <= name_size) return 0;
 
+			// the prefix must end at a '/' which is not stored
+			auto pos = filename.rfind('/', prefix_size);
+			if(pos == boost::string_view::npos || pos == 0) return std::string::npos;
+			if(filename.size() - pos - 1 > name_size || pos + 1 == filename.size()) return std::string::npos;
 
-			return buffer;
+			return pos;
 		}
 
+		/// \brief Make a record of a PAX extended header
+		inline std::string make_pax_record(std::string const& key, std::string const& value){
+			// the length includes its own digits
+			auto const base = key.size() + value.size() + 3;
+			auto length = base + 1;
+			while(length != base + std::to_string(length).size()){
+				length = base + std::to_string(length).size();
+			}
+
+			return std::to_string(length) + " " + key + "=" + value + "\n";
+		}
+
+
+		/// \brief Builds headers with a fixed modification time
+		///
+		/// All fields which are equal for every entry are formatted once in the
+		/// constructor.
+		class header_builder{
+		public:
+			explicit header_builder(std::time_t mtime = std::time(nullptr)):
+				prototype_{}
+			{
+				write< field_name::magic >(prototype_, magic);
+				write< field_name::mode >(prototype_, mode);
+				write_octal< field_name::mtime >(prototype_, static_cast< std::uint64_t >(mtime));
+			}
+
+			/// \brief Make a single ustar header
+			///
+			/// \throw std::runtime_error if the filename is empty or doesn't fit
+			std::array< char, 512 > make_posix_header(
+				boost::string_view filename, std::uint64_t size, char type = typeflag[0]
+			)const{
+				if(filename.size() == 0) throw std::runtime_error("Tar: filename is empty");
+
+				auto const split = split_name(filename);
+				if(split == std::string::npos){
+					throw std::runtime_error("Tar: filename doesn't fit into a ustar header: " + std::string(filename));
+				}
+
+				auto buffer = prototype_;
+				buffer[field_start< field_name::typeflag >::value] = type;
+
+
+				// Set filename
+				if(split == 0){
+					write< field_name::name >(buffer, filename);
+				}else{
+					write< field_name::prefix >(buffer, filename.substr(0, split));
+					write< field_name::name >(buffer, filename.substr(split + 1));
+				}
+
+
+				// Set size
+				if(size <= max_octal_size){
+					write_octal< field_name::size >(buffer, size);
+				}else{
+					// GNU base-256 encoding, big endian with the highest bit of the first byte set
+					static constexpr auto start = field_start< field_name::size >::value;
+					static constexpr auto length = field_size< field_name::size >::value;
+
+					buffer[start] = static_cast< char >(0x80);
+					for(auto i = length - 1; i > 0; --i, size >>= 8){
+						buffer[start + i] = static_cast< char >(size & 0xFF);
+					}
+				}
+
+
+				write_checksum(buffer);
+
+				return buffer;
+			}
+
+			/// \brief Write the headers of an entry
+			///
+			/// Filenames that don't fit into the ustar fields are stored in a
+			/// preceding PAX extended header. If pax_size is true, this is done
+			/// for sizes that don't fit as octal number too. Otherwise large sizes
+			/// are only stored in GNU base-256 encoding, so the count of written
+			/// bytes doesn't depend on the size.
+			void write_headers(std::ostream& os, std::string const& filename, std::uint64_t size, bool pax_size = true)const{
+				static constexpr auto name_size = field_size< field_name::name >::value;
+
+				if(filename.size() == 0) throw std::runtime_error("Tar: filename is empty");
+
+				bool const fits = split_name(filename) != std::string::npos;
+				bool const large = pax_size && size > max_octal_size;
+
+				if(fits && !large){
+					auto const header = make_posix_header(filename, size);
+					os.write(header.data(), header.size());
+					return;
+				}
+
+				std::string records;
+				if(!fits) records += make_pax_record("path", filename);
+				if(large) records += make_pax_record("size", std::to_string(size));
+
+				static char const zeros[512] = {0};
+				auto const pax_header = make_posix_header("././@PaxHeader", records.size(), 'x');
+				os.write(pax_header.data(), pax_header.size());
+				os.write(records.data(), records.size());
+				os.write(zeros, record_bytes(records.size()) - records.size());
+
+				// readers without PAX support get at least the start of the filename
+				auto const header = make_posix_header(
+					fits ? boost::string_view(filename) : boost::string_view(filename).substr(0, name_size), size
+				);
+				os.write(header.data(), header.size());
+			}
+
+		private:
+			std::array< char, 512 > prototype_;
+		};
+
 		inline std::string cut_null(std::string const& data){
 			return data.substr(0, data.find('\0'));
 		}
 
-		inline std::tuple< std::string, std::size_t > read_posix_header(std::array< char, 512 > const& buffer){
-			auto const checksum = read< field_name::checksum >(buffer);
-			auto const magic = cut_null(read< field_name::magic >(buffer));
-			auto const size = read< field_name::size >(buffer);
-			auto const filename = cut_null(read< field_name::name >(buffer));
+		inline boost::string_view cut_null(boost::string_view data){
+			return data.substr(0, data.find('\0'));
+		}
+
+		/// \brief Parse a numeric header field, which is stored as octal number
+		inline std::size_t read_octal(boost::string_view field){
+			std::size_t result = 0;
+			std::size_t i = 0;
+
+			// leading spaces are allowed
+			while(i < field.size() && field[i] == ' ') ++i;
+
+			if(i == field.size() || field[i] < '0' || field[i] > '7'){
+				throw std::runtime_error("Tar: invalid number field: '" + std::string(cut_null(field)) + "'");
+			}
+
+			for(; i < field.size() && field[i] >= '0' && field[i] <= '7'; ++i){
+				result = result * 8 + static_cast< std::size_t >(field[i] - '0');
+			}
+
+			return result;
+		}
+
+		/// \brief Forwards all output to another streambuf and counts the bytes
+		class counting_streambuf: public std::streambuf{
+		public:
+			counting_streambuf(std::streambuf* target):
+				target_(target)
+			{
+				setp(buffer_.data(), buffer_.data() + buffer_.size());
+			}
+
+			counting_streambuf(counting_streambuf const&) = delete;
+			counting_streambuf& operator=(counting_streambuf const&) = delete;
+
+			/// \brief Get the count of all written bytes
+			std::size_t count()const{
+				return count_ + static_cast< std::size_t >(pptr() - pbase());
+			}
+
+		protected:
+			int_type overflow(int_type c)override{
+				if(!flush()) return traits_type::eof();
+				if(traits_type::eq_int_type(c, traits_type::eof())) return traits_type::not_eof(c);
+
+				*pptr() = traits_type::to_char_type(c);
+				pbump(1);
+				return c;
+			}
+
+			std::streamsize xsputn(char const* data, std::streamsize size)override{
+				if(size < epptr() - pptr()){
+					return std::streambuf::xsputn(data, size);
+				}
+
+				// large blocks go directly to the target
+				if(!flush()) return 0;
+				auto const result = target_->sputn(data, size);
+				count_ += static_cast< std::size_t >(result);
+				return result;
+			}
+
+			int sync()override{
+				if(!flush()) return -1;
+				return target_->pubsync();
+			}
+
+		private:
+			bool flush(){
+				auto const size = pptr() - pbase();
+				auto const result = target_->sputn(pbase(), size);
+				count_ += static_cast< std::size_t >(result);
+				setp(buffer_.data(), buffer_.data() + buffer_.size());
+				return result == size;
+			}
+
+			std::streambuf* target_;
+			std::size_t count_ = 0;
+			std::array< char, 8192 > buffer_;
+		};
+
+
+		/// \brief Parse the size field, which is stored as octal number or in GNU base-256 encoding
+		inline std::uint64_t read_size(boost::string_view field){
+			if(field.empty() || !(static_cast< unsigned char >(field[0]) & 0x80)){
+				return read_octal(field);
+			}
+
+			if(static_cast< unsigned char >(field[0]) != 0x80){
+				throw std::runtime_error("Tar: negative or too large base-256 size field");
+			}
+
+			std::uint64_t result = 0;
+			for(std::size_t i = 1; i < field.size(); ++i){
+				if(result >> 56){
+					throw std::runtime_error("Tar: too large base-256 size field");
+				}
+				result = (result << 8) | static_cast< unsigned char >(field[i]);
+			}
+
+			return result;
+		}
+
+		/// \brief Get the filename of a header, including the ustar prefix
+		inline std::string read_filename(std::array< char, 512 > const& buffer){
+			auto const prefix = cut_null(read_view< field_name::prefix >(buffer));
+			auto const name = cut_null(read_view< field_name::name >(buffer));
 
-			if(checksum != calc_checksum(buffer)){
+			std::string result;
+			result.reserve(prefix.size() + 1 + name.size());
+			if(!prefix.empty()){
+				result.append(prefix.data(), prefix.size());
+				result += '/';
+			}
+			result.append(name.data(), name.size());
+			return result;
+		}
+
+
+		/// \brief true if the checksum field matches the header
+		inline bool check_checksum(std::array< char, 512 > const& buffer){
+			std::uint64_t stored;
+			try{
+				stored = read_octal(read_view< field_name::checksum >(buffer));
+			}catch(std::runtime_error const&){
+				return false;
+			}
+
+			if(stored == checksum_sum(buffer)) return true;
+
+			// some old implementations sum signed bytes
+			std::int64_t sum = 0;
+			for(auto c: buffer) sum += static_cast< signed char >(c);
+
+			static constexpr auto start = field_start< field_name::checksum >::value;
+			static constexpr auto size  = field_size< field_name::checksum >::value;
+			for(auto i = start; i < start + size; ++i) sum -= static_cast< signed char >(buffer[i]) - ' ';
+
+			return static_cast< std::int64_t >(stored) == sum;
+		}
+
+
+		/// \brief Content of a single header record
+		struct entry_header{
+			std::string filename;
+			std::uint64_t size;
+			char typeflag;
+		};
+
+		inline entry_header read_posix_header(std::array< char, 512 > const& buffer){
+			auto const magic = cut_null(read_view< field_name::magic >(buffer));
+
+			if(!check_checksum(buffer)){
 				throw std::runtime_error("Tar: loaded file with wrong checksum");
 			}
 
-			if(magic != "ustar"){
-				throw std::runtime_error("Tar: loaded file without magic 'ustar', magic is: '" + magic + "'");
+			// GNU tar writes "ustar " with a space
+			if(magic != "ustar" && magic != "ustar "){
+				throw std::runtime_error("Tar: loaded file without magic 'ustar', magic is: '" + std::string(magic) + "'");
 			}
 
-			return std::make_tuple(std::move(filename), tools::string_to< std::size_t >(size));
+			return entry_header{
+				read_filename(buffer),
+				read_size(read_view< field_name::size >(buffer)),
+				buffer[field_start< field_name::typeflag >::value]
+			};
 		}
 
 
+		/// \brief Overrides from extended headers for the next entry
+		struct extended_header{
+			bool has_path = false;
+			std::string path;
+
+			bool has_size = false;
+			std::uint64_t size = 0;
+		};
+
+		/// \brief Largest accepted content of an extended header
+		constexpr std::uint64_t max_extended_size = 1 << 20;
+
+		/// \brief true for PAX extended ('x'), PAX global ('g') and GNU long name ('L') headers
+		inline bool is_extended(char typeflag){
+			return typeflag == 'x' || typeflag == 'g' || typeflag == 'L';
+		}
+
+		/// \brief Parse the content of an extended header
+		inline void apply_extended(char typeflag, std::string const& content, extended_header& extended){
+			if(typeflag == 'L'){
+				extended.has_path = true;
+				extended.path = cut_null(content);
+				return;
+			}
+
+			// global headers only set defaults for fields that are not supported
+			if(typeflag != 'x') return;
+
+			for(std::size_t pos = 0; pos < content.size() && content[pos] != '\0';){
+				// record: "<length> <key>=<value>\n", length includes itself
+				auto const space = content.find(' ', pos);
+				if(space == std::string::npos || space == pos){
+					throw std::runtime_error("Tar: corrupt pax extended header");
+				}
+
+				std::size_t length = 0;
+				for(auto i = pos; i < space; ++i){
+					if(content[i] < '0' || content[i] > '9'){
+						throw std::runtime_error("Tar: corrupt pax extended header");
+					}
+					length = length * 10 + static_cast< std::size_t >(content[i] - '0');
+				}
+
+				auto const end = pos + length;
+				auto const equal = content.find('=', space);
+				if(end > content.size() || end <= space + 1 || content[end - 1] != '\n' || equal >= end){
+					throw std::runtime_error("Tar: corrupt pax extended header");
+				}
+
+				auto const key = content.substr(space + 1, equal - space - 1);
+				auto const value = content.substr(equal + 1, end - equal - 2);
+
+				if(key == "path"){
+					extended.has_path = true;
+					extended.path = value;
+				}else if(key == "size"){
+					if(value.empty() || value.find_first_not_of("0123456789") != std::string::npos){
+						throw std::runtime_error("Tar: invalid pax size: '" + value + "'");
+					}
+					// 19 digits always fit into 64 bit
+					if(value.size() > 19){
+						throw std::runtime_error("Tar: too large pax size: '" + value + "'");
+					}
+					extended.has_size = true;
+					extended.size = std::stoull(value);
+				}
+
+				pos = end;
+			}
+		}
+
+
+		/// \brief Read the next header of an archive
+		///
+		/// Extended headers are consumed and applied to the following entry.
+		///
+		/// \return false if the end of the archive has been reached
+		inline bool read_next_header(std::istream& is, std::string& filename, std::size_t& size){
+			static constexpr std::array< char, 512 > empty_buffer{};
+
+			extended_header extended;
+			for(;;){
+				std::array< char, 512 > buffer;
+				is.read(buffer.data(), 512);
+
+				if(!is){
+					throw std::runtime_error("Corrupt tar-file.");
+				}
+
+				if(buffer == empty_buffer){
+					is.read(buffer.data(), 512);
+					if(buffer != empty_buffer || !is || extended.has_path || extended.has_size){
+						throw std::runtime_error("Corrupt tar-file.");
+					}
+					return false;
+				}
+
+				auto header = read_posix_header(buffer);
+
+				if(is_extended(header.typeflag)){
+					if(header.size > max_extended_size){
+						throw std::runtime_error("Tar: extended header too large");
+					}
+
+					std::string content(static_cast< std::size_t >(header.size), '\0');
+					is.read(&content[0], static_cast< std::streamsize >(content.size()));
+					is.ignore(static_cast< std::streamsize >(record_bytes(header.size) - header.size));
+					if(!is){
+						throw std::runtime_error("Corrupt tar-file.");
+					}
+
+					apply_extended(header.typeflag, content, extended);
+					continue;
+				}
+
+				if(extended.has_path) header.filename = std::move(extended.path);
+				if(extended.has_size) header.size = extended.size;
+
+				if(header.size > std::numeric_limits< std::size_t >::max()){
+					throw std::runtime_error("Tar: entry too large for this platform: " + header.filename);
+				}
+
+				filename = std::move(header.filename);
+				size = static_cast< std::size_t >(header.size);
+				return true;
+			}
+		}
+
+
+		/// \brief Read only access to a range of another streambuf
+		///
+		/// The range is read by seeking the source, so several range_streambuf
+		/// objects can use the same source one after another.
+		class range_streambuf: public std::streambuf{
+		public:
+			range_streambuf(std::streambuf* source, std::streamoff offset, std::size_t size):
+				source_(source),
+				begin_(offset),
+				end_(offset + static_cast< std::streamoff >(size)),
+				pos_(offset)
+			{
+				setg(buffer_.data(), buffer_.data(), buffer_.data());
+			}
+
+			range_streambuf(range_streambuf const&) = delete;
+			range_streambuf& operator=(range_streambuf const&) = delete;
+
+		protected:
+			int_type underflow()override{
+				if(gptr() < egptr()) return traits_type::to_int_type(*gptr());
+
+				auto const count = fetch(buffer_.data(), static_cast< std::streamsize >(buffer_.size()));
+				if(count <= 0) return traits_type::eof();
+
+				setg(buffer_.data(), buffer_.data(), buffer_.data() + count);
+				return traits_type::to_int_type(*gptr());
+			}
+
+			std::streamsize xsgetn(char* data, std::streamsize size)override{
+				// use the buffered data first
+				std::streamsize result = std::min< std::streamsize >(size, egptr() - gptr());
+				std::copy(gptr(), gptr() + result, data);
+				gbump(static_cast< int >(result));
+
+				// large blocks bypass the buffer
+				while(result < size){
+					auto const count = fetch(data + result, size - result);
+					if(count <= 0) break;
+					result += count;
+				}
+
+				return result;
+			}
+
+			std::streamsize showmanyc()override{
+				return end_ - pos_;
+			}
+
+			pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which)override{
+				auto const current = pos_ - (egptr() - gptr()) - begin_;
+
+				off_type target = off;
+				if(dir == std::ios_base::cur) target += current;
+				if(dir == std::ios_base::end) target += end_ - begin_;
+
+				return seekpos(pos_type(target), which);
+			}
+
+			pos_type seekpos(pos_type pos, std::ios_base::openmode which)override{
+				off_type const target = pos;
+
+				if(!(which & std::ios_base::in) || target < 0 || target > end_ - begin_){
+					return pos_type(off_type(-1));
+				}
+
+				pos_ = begin_ + target;
+				setg(buffer_.data(), buffer_.data(), buffer_.data());
+				return pos;
+			}
+
+		private:
+			/// \brief Read up to size bytes at pos_ from the source
+			std::streamsize fetch(char* data, std::streamsize size){
+				size = std::min< std::streamsize >(size, end_ - pos_);
+				if(size <= 0) return 0;
+
+				if(source_->pubseekpos(pos_, std::ios_base::in) == pos_type(off_type(-1))){
+					return 0;
+				}
+
+				auto const count = source_->sgetn(data, size);
+				if(count > 0) pos_ += count;
+				return count;
+			}
+
+			std::streambuf* source_;
+			std::streamoff const begin_;
+			std::streamoff const end_;
+
+			/// \brief Position in source_ behind the buffered data
+			std::streamoff pos_;
+
+			std::array< char, 8192 > buffer_;
+		};
+
+
+		/// \brief Read only streambuf over memory
+		class memory_streambuf: public std::streambuf{
+		public:
+			memory_streambuf(char const* data, std::size_t size){
+				// the get area is never written
+				auto const begin = const_cast< char* >(data);
+				setg(begin, begin, begin + size);
+			}
+
+		protected:
+			pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which)override{
+				off_type target = off;
+				if(dir == std::ios_base::cur) target += gptr() - eback();
+				if(dir == std::ios_base::end) target += egptr() - eback();
+				return seekpos(pos_type(target), which);
+			}
+
+			pos_type seekpos(pos_type pos, std::ios_base::openmode which)override{
+				off_type const target = pos;
+
+				if(!(which & std::ios_base::in) || target < 0 || target > egptr() - eback()){
+					return pos_type(off_type(-1));
+				}
+
+				setg(eback(), eback() + target, egptr());
+				return pos;
+			}
+		};
+
+
+		/// \brief A read only memory mapped file
+		struct mapped_file{
+			mapped_file(std::string const& filename):
+				file(filename.c_str(), boost::interprocess::read_only),
+				region(file, boost::interprocess::read_only)
+				{}
+
+			boost::interprocess::file_mapping file;
+			boost::interprocess::mapped_region region;
+		};
+
+
 	} }
 
 
 	/// \brief Write a simple tar file
 	class tar_writer{
 	public:
-		tar_writer(std::string const& filename):
-			outfile_(new std::ofstream(filename.c_str(), std::ios_base::out | std::ios_base::binary)),
-			out_(*outfile_) {}
+		/// \brief Create a tar file or append to an existing one
+		///
+		/// In append mode the end marker of an existing archive is overwritten
+		/// by the new entries, the filenames of the existing entries take part
+		/// in the duplicate check. A missing file is created.
+		///
+		/// \throw std::runtime_error if the existing archive is corrupt
+		tar_writer(std::string const& filename, bool append = false):
+			outfile_(open(filename, append)),
+			out_(*outfile_)
+		{
+			if(append) seek_end_of_archive();
+		}
 
 		tar_writer(std::ostream& out):
 			out_(out) {}
@@ -220,27 +817,172 @@ namespace tools {
 		}
 
 		void write(std::string const& filename, std::string const& content){
+			write(filename, content.data(), content.size());
+		}
+
+		/// \brief Write an entry directly from a buffer
+		void write(std::string const& filename, char const* data, std::size_t size){
+			add_filename(filename);
+
+			headers_.write_headers(out_, filename, size);
+			out_.write(data, size);
+			write_end_record(size);
+		}
+
+		/// \brief Write an entry with a size known before
+		///
+		/// The writer writes directly to the tar stream, nothing is buffered.
+		/// It must write exactly size bytes.
+		///
+		/// If the writer throws, the exception is passed on. The header is
+		/// written already, so the archive is unusable afterwards and all
+		/// further writes throw.
+		void write(std::string const& filename, std::size_t size, std::function< void(std::ostream&) > const& writer){
+			add_filename(filename);
+
+			headers_.write_headers(out_, filename, size);
+
+			auto const written = write_counted(writer, size);
+			if(written < size){
+				// keep the archive consistent
+				write_zeros(size - written);
+			}
+
+			write_end_record(size);
+
+			if(written != size){
+				if(written > size) out_.setstate(std::ios_base::badbit);
+
+				throw std::runtime_error(tools::make_string(
+					"Tar: entry '", filename, "' was announced with ", size, " bytes, but ", written, " bytes have been written"
+				));
+			}
+		}
+
+		/// \brief Write an entry with a size that is unknown before
+		///
+		/// On a seekable stream the writer writes directly to the tar stream and
+		/// the header is patched afterwards. Otherwise the entry is buffered.
+		///
+		/// If the writer throws on a seekable stream, the exception is passed
+		/// on and the archive is unusable afterwards, like in the write with
+		/// known size.
+		void write(std::string const& filename, std::function< void(std::ostream&) > const& writer){
+			auto const header_pos = out_.tellp();
+
+			if(header_pos == std::ostream::pos_type(-1)){
+				std::ostringstream os(std::ios_base::out | std::ios_base::binary);
+				writer(os);
+				write(filename, os.str());
+				return;
+			}
+
+			add_filename(filename);
+
+			// reserve the headers, their content is unknown until the entry is written
+			headers_.write_headers(out_, filename, 0, false);
+
+			auto const size = write_counted(writer, 0);
+			auto const end_pos = out_.tellp();
+
+			// a size independent PAX header keeps the length of the headers
+			out_.seekp(header_pos);
+			headers_.write_headers(out_, filename, size, false);
+			out_.seekp(end_pos);
+
+			write_end_record(size);
+		}
+
+	private:
+		/// \brief Open the file for appending if possible, otherwise create it
+		static std::unique_ptr< std::ofstream > open(std::string const& filename, bool append){
+			if(append){
+				// in and out keeps the existing content
+				std::unique_ptr< std::ofstream > file(new std::ofstream(
+					filename.c_str(), std::ios_base::in | std::ios_base::out | std::ios_base::binary
+				));
+
+				if(file->is_open()) return file;
+			}
+
+			return std::unique_ptr< std::ofstream >(
+				new std::ofstream(filename.c_str(), std::ios_base::out | std::ios_base::binary)
+			);
+		}
+
+		/// \brief Register all entries of the existing archive and set the output position to its end marker
+		void seek_end_of_archive(){
+			std::istream is(out_.rdbuf());
+
+			is.seekg(0, std::ios_base::end);
+			if(is.tellg() <= 0) return;
+			is.seekg(0);
+
+			std::string filename;
+			std::size_t size;
+			while(impl::tar::read_next_header(is, filename, size)){
+				add_filename(filename);
+				is.seekg(static_cast< std::streamoff >(impl::tar::record_bytes(size)), std::ios_base::cur);
+			}
+
+			out_.seekp(is.tellg() - std::streamoff(1024));
+		}
+
+		/// \brief Throws on duplicate filenames and after a failed entry
+		void add_filename(std::string const& filename){
+			if(out_.bad()){
+				throw std::runtime_error("Tar: archive is unusable after a failed entry: " + filename);
+			}
+
 			if(!filenames_.emplace(filename).second){
 				throw std::runtime_error("Duplicate filename in tar-file: " + filename);
 			}
+		}
+
+		/// \brief Call the writer with the tar stream and get the count of written bytes
+		///
+		/// If the writer throws, the entry is filled with zeros up to the
+		/// announced size and its last record, the output stream gets the
+		/// badbit and the exception is rethrown.
+		std::size_t write_counted(std::function< void(std::ostream&) > const& writer, std::size_t size){
+			impl::tar::counting_streambuf buffer(out_.rdbuf());
+			std::ostream os(&buffer);
+
+			try{
+				writer(os);
+			}catch(...){
+				os.flush();
+				auto const written = buffer.count();
+				if(written < size) write_zeros(size - written);
+				write_end_record(std::max(size, written));
+				out_.flush();
+
+				out_.setstate(std::ios_base::badbit);
+				throw;
+			}
 
-			auto const header = impl::tar::make_posix_header(filename, content.size());
+			os.flush();
 
-			std::size_t end_record_bytes = (512 - (content.size() % 512)) % 512;
-			std::vector< char > buffer(end_record_bytes);
+			if(!os){
+				out_.setstate(std::ios_base::badbit);
+				throw std::runtime_error("Tar: can't write entry");
+			}
 
-			out_.write(header.data(), header.size());
-			out_.write(content.data(), content.size());
-			out_.write(buffer.data(), buffer.size());
+			return buffer.count();
 		}
 
-		void write(std::string const& filename, std::function< void(std::ostream&) > const& writer) {
-			std::ostringstream os(std::ios_base::out | std::ios_base::binary);
-			writer(os);
-			write(filename, os.str());
+		/// \brief Fill the last record of an entry with zeros
+		void write_end_record(std::size_t size){
+			write_zeros((512 - (size % 512)) % 512);
+		}
+
+		/// \brief Write count zero bytes
+		void write_zeros(std::size_t count){
+			static char const zeros[512] = {0};
+			for(; count > 512; count -= 512) out_.write(zeros, 512);
+			out_.write(zeros, count);
 		}
 
-	private:
 		/// \brief Output file, if the filename constructor have been called
 		std::unique_ptr< std::ofstream > outfile_;
 
@@ -249,6 +991,9 @@ namespace tools {
 
 		/// \brief No filename duplicates
 		std::set< std::string > filenames_;
+
+		/// \brief Formats the headers with the construction time as mtime
+		impl::tar::header_builder headers_;
 	};
 
 
@@ -279,25 +1024,11 @@ namespace tools {
 
 	private:
 		void init(std::istream& is){
-			static constexpr std::array< char, 512 > empty_buffer{};
-
 			std::array< char, 512 > buffer;
-			while(is){
-				is.read(buffer.data(), 512);
-
-				if(buffer == empty_buffer){
-					is.read(buffer.data(), 512);
-					if(buffer != empty_buffer || !is){
-						throw std::runtime_error("Corrupt tar-file.");
-					}
-					break;
-				}
-
-				std::string filename;
-				std::size_t size;
-				std::tie(filename, size) = impl::tar::read_posix_header(buffer);
-
-				auto result = files_.emplace(std::move(filename), std::vector< char >(size));
+			std::string filename;
+			std::size_t size;
+			while(impl::tar::read_next_header(is, filename, size)){
+				auto result = files_.emplace(filename, std::vector< char >(size));
 				if(!result.second){
 					throw std::runtime_error("Duplicate filename-entry while reading tar-file: " + filename);
 				}
@@ -319,6 +1050,218 @@ namespace tools {
 	};
 
 
+	/// \brief Read a tar file with random access to its entries
+	///
+	/// The constructor only scans the headers and stores the position of every
+	/// entry. The content is read on demand, so opening a large archive costs
+	/// time and memory proportional to the count of entries only.
+	///
+	/// The member functions use a shared file stream, they are not thread safe.
+	class indexed_tar_reader{
+	public:
+		/// \brief Position of an entry in the archive
+		struct entry{
+			/// \brief Offset of the content from the start of the archive
+			std::uint64_t offset;
+
+			/// \brief Size of the content in bytes
+			std::uint64_t size;
+		};
+
+
+		indexed_tar_reader(std::string const& filename):
+			is_(filename.c_str(), std::ios_base::in | std::ios_base::binary)
+		{
+			if(!is_.is_open()){
+				throw std::runtime_error("Can't open tar-file: " + filename);
+			}
+
+			init();
+		}
+
+
+		/// \brief Get all entries by filename
+		std::map< std::string, entry > const& entries()const{
+			return entries_;
+		}
+
+		/// \brief true if the archive contains an entry with the filename
+		bool contains(std::string const& filename)const{
+			return entries_.find(filename) != entries_.end();
+		}
+
+		/// \brief Get the position of an entry
+		entry const& find(std::string const& filename)const{
+			auto iter = entries_.find(filename);
+			if(iter == entries_.end()){
+				throw std::runtime_error("Filename-entry not fount in tar-file: " + filename);
+			}
+			return iter->second;
+		}
+
+
+		/// \brief Get the content of an entry
+		std::string get(std::string const& filename){
+			auto const& position = find(filename);
+
+			std::string result(static_cast< std::size_t >(position.size), '\0');
+			read_content(position, &result[0]);
+			return result;
+		}
+
+		/// \brief Read the content of an entry into a buffer of at least find(filename).size bytes
+		void get(std::string const& filename, char* buffer){
+			read_content(find(filename), buffer);
+		}
+
+		/// \brief Call reader with a stream to the content of an entry
+		///
+		/// The stream reads directly from the archive and supports seeking
+		/// inside of the entry.
+		void read(std::string const& filename, std::function< void(std::istream&) > const& reader){
+			auto const& position = find(filename);
+
+			is_.clear();
+			impl::tar::range_streambuf buffer(
+				is_.rdbuf(), static_cast< std::streamoff >(position.offset), static_cast< std::size_t >(position.size)
+			);
+			std::istream is(&buffer);
+			reader(is);
+		}
+
+
+	private:
+		void init(){
+			is_.seekg(0, std::ios_base::end);
+			std::uint64_t const file_size = is_.tellg();
+			is_.seekg(0);
+
+			std::string filename;
+			std::size_t size;
+			while(impl::tar::read_next_header(is_, filename, size)){
+				std::uint64_t const offset = is_.tellg();
+
+				// compare before rounding, so a corrupt size can't overflow
+				if(
+					offset > file_size || size > file_size - offset ||
+					impl::tar::record_bytes(size) > file_size - offset
+				){
+					throw std::runtime_error("Tar filename-entry with illegal size: " + filename);
+				}
+
+				if(!entries_.emplace(filename, entry{offset, size}).second){
+					throw std::runtime_error("Duplicate filename-entry while reading tar-file: " + filename);
+				}
+
+				is_.seekg(static_cast< std::streamoff >(impl::tar::record_bytes(size)), std::ios_base::cur);
+			}
+		}
+
+		void read_content(entry const& position, char* buffer){
+			is_.clear();
+			is_.seekg(static_cast< std::streamoff >(position.offset));
+			is_.read(buffer, static_cast< std::streamsize >(position.size));
+
+			if(!is_){
+				throw std::runtime_error("Can't read tar-file entry");
+			}
+		}
+
+		/// \brief The archive
+		std::ifstream is_;
+
+		/// \brief Map of filenames and positions
+		std::map< std::string, entry > entries_;
+	};
+
+
+	/// \brief Read a memory mapped tar file without copying its entries
+	///
+	/// The archive is mapped into memory and only the headers are read by the
+	/// constructor. All member functions are const and thread safe. The views
+	/// to the content stay valid as long as the reader or a copy of mapping()
+	/// exists.
+	class mapped_tar_reader{
+	public:
+		mapped_tar_reader(std::string const& filename){
+			std::shared_ptr< impl::tar::mapped_file > file;
+
+			try{
+				file = std::make_shared< impl::tar::mapped_file >(filename);
+			}catch(boost::interprocess::interprocess_exception const& error){
+				throw std::runtime_error("Can't map tar-file (" + std::string(error.what()) + "): " + filename);
+			}
+
+			init(static_cast< char const* >(file->region.get_address()), file->region.get_size());
+
+			mapping_ = std::move(file);
+		}
+
+
+		/// \brief Get all entries by filename
+		std::map< std::string, boost::string_view > const& entries()const{
+			return entries_;
+		}
+
+		/// \brief true if the archive contains an entry with the filename
+		bool contains(std::string const& filename)const{
+			return entries_.find(filename) != entries_.end();
+		}
+
+		/// \brief Get a view to the content of an entry
+		boost::string_view get(std::string const& filename)const{
+			auto iter = entries_.find(filename);
+			if(iter == entries_.end()){
+				throw std::runtime_error("Filename-entry not fount in tar-file: " + filename);
+			}
+			return iter->second;
+		}
+
+		/// \brief Call reader with a stream that reads directly from the mapped content of an entry
+		void read(std::string const& filename, std::function< void(std::istream&) > const& reader)const{
+			auto const content = get(filename);
+			impl::tar::memory_streambuf buffer(content.data(), content.size());
+			std::istream is(&buffer);
+			reader(is);
+		}
+
+		/// \brief Get the owner of the mapped memory
+		std::shared_ptr< void const > mapping()const{
+			return mapping_;
+		}
+
+
+	private:
+		void init(char const* data, std::size_t size){
+			impl::tar::memory_streambuf buffer(data, size);
+			std::istream is(&buffer);
+
+			std::string filename;
+			std::size_t entry_size;
+			while(impl::tar::read_next_header(is, filename, entry_size)){
+				std::size_t const pos = static_cast< std::size_t >(is.tellg());
+
+				// compare before rounding, so a corrupt size can't overflow
+				if(entry_size > size - pos || impl::tar::record_bytes(entry_size) > size - pos){
+					throw std::runtime_error("Tar filename-entry with illegal size: " + filename);
+				}
+
+				if(!entries_.emplace(filename, boost::string_view(data + pos, entry_size)).second){
+					throw std::runtime_error("Duplicate filename-entry while reading tar-file: " + filename);
+				}
+
+				is.seekg(static_cast< std::streamoff >(impl::tar::record_bytes(entry_size)), std::ios_base::cur);
+			}
+		}
+
+		/// \brief Keeps the mapping alive
+		std::shared_ptr< void const > mapping_;
+
+		/// \brief Map of filenames and contents
+		std::map< std::string, boost::string_view > entries_;
+	};
+
+
 }
 
 
@@ -0,0 +1,440 @@
+/// \file tools/tar_extract.hpp
+/// \author Benjamin Buch (benni.buch@gmail.com)
+/// \brief Parallel verification and extraction of .tar files
+///
+/// Copyright (c) 2015 Benjamin Buch (benni dot buch at gmail dot com)
+///
+/// Distributed under the Boost Software License, Version 1.0. (See accompanying
+/// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+///
+#ifndef _tools_tar_extract_hpp_INCLUDED_
+#define _tools_tar_extract_hpp_INCLUDED_
+
+#include "tar.hpp"
+
+#include <boost/filesystem.hpp>
+
+#include <atomic>
+#include <future>
+#include <thread>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+#include <set>
+#include <map>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define TOOLS_TAR_EXTRACT_POSIX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+namespace tools {
+
+
+	/// \brief Result of the verification or extraction of a single entry
+	struct tar_entry_status{
+		/// \brief Filename of the entry
+		std::string filename;
+
+		/// \brief Offset of the content from the start of the archive
+		std::uint64_t offset;
+
+		/// \brief Size of the content in bytes
+		std::uint64_t size;
+
+		/// \brief Description of the problem, empty if the entry is fine
+		std::string error;
+	};
+
+
+	/// \brief Check all headers of a tar file
+	///
+	/// Every entry gets a status, corrupt entries are reported instead of
+	/// thrown. If a header is damaged so badly that the following entries
+	/// can't be found, the scan stops with a status for this position.
+	///
+	/// \param filename The tar file
+	/// \param threads Count of threads, 0 for all hardware threads
+	///
+	/// \throw std::runtime_error if the file can't be opened
+	std::vector< tar_entry_status > verify_tar(std::string const& filename, std::size_t threads = 0);
+
+	/// \brief Extract all entries of a tar file into a directory
+	///
+	/// The entries are written in parallel. On Linux the content is copied by
+	/// copy_file_range inside of the kernel, on other POSIX systems by pread
+	/// and write. Directory entries are created, regular files are written.
+	/// Entries with corrupt headers, unsafe filenames (absolute or with ..),
+	/// other types (like links) or write errors get an error in their
+	/// status, the other entries are extracted anyway.
+	///
+	/// If several entries have the same filename, only the last one is
+	/// extracted, like tar does. The earlier ones get an error.
+	///
+	/// \param filename The tar file
+	/// \param directory Target directory, it is created if necessary
+	/// \param threads Count of threads, 0 for all hardware threads
+	///
+	/// \throw std::runtime_error if the file can't be opened
+	std::vector< tar_entry_status > extract_tar(
+		std::string const& filename, std::string const& directory, std::size_t threads = 0
+	);
+
+
+	//=============================================================================
+	// Implementation
+	//=============================================================================
+
+	namespace impl{ namespace tar{
+
+
+		/// \brief Calls f(i) for all i in [0, count) on threads threads
+		template < typename F >
+		void parallel_for(std::size_t count, std::size_t threads, F const& f){
+			if(threads == 0){
+				threads = std::max< std::size_t >(1, std::thread::hardware_concurrency());
+			}
+			threads = std::min(threads, count);
+
+			std::atomic< std::size_t > next(0);
+			auto const worker = [&]{
+				for(std::size_t i = next++; i < count; i = next++) f(i);
+			};
+
+			std::vector< std::future< void > > futures;
+			for(std::size_t i = 1; i < threads; ++i){
+				futures.push_back(std::async(std::launch::async, worker));
+			}
+
+			worker();
+
+			for(auto& future: futures) future.get();
+		}
+
+
+		/// \brief Header of an entry as found by scan_headers
+		struct scanned_header{
+			std::array< char, 512 > buffer;
+			tar_entry_status status;
+		};
+
+		/// \brief Find all headers without checking them
+		inline std::vector< scanned_header > scan_headers(std::string const& filename){
+			std::ifstream is(filename.c_str(), std::ios_base::in | std::ios_base::binary);
+			if(!is.is_open()){
+				throw std::runtime_error("Can't open tar-file: " + filename);
+			}
+
+			is.seekg(0, std::ios_base::end);
+			std::uint64_t const file_size = is.tellg();
+			is.seekg(0);
+
+			static constexpr std::array< char, 512 > empty_buffer{};
+
+			std::vector< scanned_header > result;
+			std::uint64_t pos = 0;
+			extended_header extended;
+			std::string extended_error;
+			for(;;){
+				scanned_header header;
+				header.status.offset = pos + 512;
+				header.status.size = 0;
+
+				is.seekg(static_cast< std::streamoff >(pos));
+				is.read(header.buffer.data(), 512);
+				if(!is){
+					header.status.error = "Missing end of archive";
+					result.push_back(std::move(header));
+					break;
+				}
+
+				if(header.buffer == empty_buffer) break;
+
+				header.status.filename = read_filename(header.buffer);
+
+				try{
+					header.status.size = read_size(read_view< field_name::size >(header.buffer));
+				}catch(std::exception const& error){
+					// without a size the next header can't be found
+					header.status.error = error.what();
+					result.push_back(std::move(header));
+					break;
+				}
+
+				// the header was read, so offset <= file_size; sizes are compared
+				// with the remaining bytes, so a corrupt size can't overflow
+				std::uint64_t const remaining = file_size - header.status.offset;
+
+				char const typeflag = header.buffer[field_start< field_name::typeflag >::value];
+				if(is_extended(typeflag) && header.status.size <= remaining){
+					// extended headers belong to the next entry
+					try{
+						read_posix_header(header.buffer);
+
+						if(header.status.size > max_extended_size){
+							throw std::runtime_error("Tar: extended header too large");
+						}
+
+						std::string content(static_cast< std::size_t >(header.status.size), '\0');
+						is.read(&content[0], static_cast< std::streamsize >(content.size()));
+						apply_extended(typeflag, content, extended);
+					}catch(std::exception const& error){
+						extended_error = error.what();
+					}
+
+					pos = header.status.offset + record_bytes(header.status.size);
+					continue;
+				}
+
+				if(extended.has_path) header.status.filename = std::move(extended.path);
+				if(extended.has_size) header.status.size = extended.size;
+				header.status.error = std::move(extended_error);
+				extended = extended_header();
+				extended_error.clear();
+
+				// without a valid size the next header can't be found
+				if(header.status.size > remaining || record_bytes(header.status.size) > remaining){
+					header.status.error = "Tar filename-entry with illegal size";
+					result.push_back(std::move(header));
+					break;
+				}
+
+				pos = header.status.offset + record_bytes(header.status.size);
+				result.push_back(std::move(header));
+			}
+
+			return result;
+		}
+
+		/// \brief Set the error of all headers with wrong checksum, magic or duplicate filename
+		inline void check_headers(std::vector< scanned_header >& headers, std::size_t threads){
+			parallel_for(headers.size(), threads, [&headers](std::size_t i){
+				auto& header = headers[i];
+				if(!header.status.error.empty()) return;
+
+				try{
+					read_posix_header(header.buffer);
+				}catch(std::exception const& error){
+					header.status.error = error.what();
+				}
+			});
+
+			std::set< std::string > filenames;
+			for(auto& header: headers){
+				if(!filenames.emplace(header.status.filename).second && header.status.error.empty()){
+					header.status.error = "Duplicate filename-entry";
+				}
+			}
+		}
+
+		/// \brief Copy size bytes at offset from an archive to a new file
+		/// \throw std::runtime_error
+		inline void copy_entry(
+#ifdef TOOLS_TAR_EXTRACT_POSIX
+			int archive,
+#else
+			std::string const& archive,
+#endif
+			std::uint64_t offset, std::uint64_t size, std::string const& target
+		){
+#ifdef TOOLS_TAR_EXTRACT_POSIX
+			int const out = ::open(target.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+			if(out < 0){
+				throw std::runtime_error("Can't create file: " + target);
+			}
+
+			off_t in_offset = static_cast< off_t >(offset);
+			std::uint64_t remaining = size;
+
+#ifdef __linux__
+			// copy inside of the kernel, falls back to pread and write if unsupported
+			while(remaining > 0){
+				auto const count = ::copy_file_range(archive, &in_offset, out, nullptr, remaining, 0);
+				if(count <= 0) break;
+				remaining -= static_cast< std::uint64_t >(count);
+			}
+#endif
+
+			std::vector< char > buffer(remaining > 0 ? std::min< std::uint64_t >(remaining, 1 << 20) : 0);
+			while(remaining > 0){
+				auto const count = ::pread(archive, buffer.data(), std::min< std::uint64_t >(remaining, buffer.size()), in_offset);
+				if(count <= 0) break;
+
+				if(::write(out, buffer.data(), count) != count) break;
+
+				in_offset += count;
+				remaining -= static_cast< std::uint64_t >(count);
+			}
+
+			bool const closed = ::close(out) == 0;
+
+			if(remaining > 0 || !closed){
+				throw std::runtime_error("Can't write file: " + target);
+			}
+#else
+			std::ifstream is(archive.c_str(), std::ios_base::in | std::ios_base::binary);
+			std::ofstream os(target.c_str(), std::ios_base::out | std::ios_base::binary);
+			if(!os.is_open()){
+				throw std::runtime_error("Can't create file: " + target);
+			}
+
+			is.seekg(static_cast< std::streamoff >(offset));
+			std::vector< char > buffer(static_cast< std::size_t >(std::min< std::uint64_t >(size, 1 << 20)));
+			for(std::uint64_t remaining = size; remaining > 0;){
+				auto const count = static_cast< std::streamsize >(std::min< std::uint64_t >(remaining, buffer.size()));
+				is.read(buffer.data(), count);
+				os.write(buffer.data(), count);
+
+				if(!is || !os){
+					throw std::runtime_error("Can't write file: " + target);
+				}
+
+				remaining -= static_cast< std::uint64_t >(count);
+			}
+#endif
+		}
+
+		/// \brief Find and check all headers of a tar file
+		/// \throw std::runtime_error if the file can't be opened
+		inline std::vector< scanned_header > read_headers(std::string const& filename, std::size_t threads){
+			auto headers = scan_headers(filename);
+			check_headers(headers, threads);
+			return headers;
+		}
+
+		/// \brief true if the typeflag marks a regular file
+		inline bool is_regular_file(char typeflag){
+			return typeflag == '0' || typeflag == '\0' || typeflag == '7';
+		}
+
+		/// \brief true if the typeflag marks a directory
+		inline bool is_directory(char typeflag){
+			return typeflag == '5';
+		}
+
+		/// \brief Path without . and trailing /, equal for all spellings of an entry
+		inline std::string normal_path(boost::filesystem::path const& path){
+			boost::filesystem::path result;
+			for(auto const& part: path){
+				if(!part.empty() && part != ".") result /= part;
+			}
+			return result.generic_string();
+		}
+
+		/// \brief true if the path stays inside of the target directory
+		inline bool is_safe_path(boost::filesystem::path const& path){
+			if(path.empty() || path.has_root_path()) return false;
+
+			for(auto const& part: path){
+				if(part == "..") return false;
+			}
+
+			return true;
+		}
+
+
+	} }
+
+
+	inline std::vector< tar_entry_status > verify_tar(std::string const& filename, std::size_t threads){
+		auto headers = impl::tar::read_headers(filename, threads);
+
+		std::vector< tar_entry_status > result;
+		result.reserve(headers.size());
+		for(auto& header: headers){
+			result.push_back(std::move(header.status));
+		}
+
+		return result;
+	}
+
+	inline std::vector< tar_entry_status > extract_tar(
+		std::string const& filename, std::string const& directory, std::size_t threads
+	){
+		namespace fs = boost::filesystem;
+
+		auto headers = impl::tar::read_headers(filename, threads);
+
+		std::vector< tar_entry_status > result;
+		result.reserve(headers.size());
+		std::vector< char > typeflags;
+		typeflags.reserve(headers.size());
+		for(auto& header: headers){
+			result.push_back(std::move(header.status));
+			typeflags.push_back(header.buffer[impl::tar::field_start< impl::tar::field_name::typeflag >::value]);
+		}
+
+		// check_headers keeps the first of equal filenames, but the last one
+		// is extracted; no two entries may be written to the same target
+		std::map< std::string, std::size_t > targets;
+		for(std::size_t i = 0; i < result.size(); ++i){
+			auto& status = result[i];
+			if(!status.error.empty() && status.error != "Duplicate filename-entry") continue;
+			status.error.clear();
+
+			fs::path const path(status.filename);
+			if(!impl::tar::is_safe_path(path)){
+				status.error = "Unsafe filename-entry: " + status.filename;
+				continue;
+			}
+
+			auto const typeflag = typeflags[i];
+			if(!impl::tar::is_regular_file(typeflag) && !impl::tar::is_directory(typeflag)){
+				status.error = std::string("Unsupported entry type '") + typeflag + "': " + status.filename;
+				continue;
+			}
+
+			auto const inserted = targets.emplace(impl::tar::normal_path(path), i);
+			if(!inserted.second){
+				result[inserted.first->second].error = "Duplicate filename-entry, replaced by a later entry";
+				inserted.first->second = i;
+			}
+		}
+
+#ifdef TOOLS_TAR_EXTRACT_POSIX
+		int const archive = ::open(filename.c_str(), O_RDONLY);
+		if(archive < 0){
+			throw std::runtime_error("Can't open tar-file: " + filename);
+		}
+#else
+		std::string const& archive = filename;
+#endif
+
+		impl::tar::parallel_for(result.size(), threads, [&](std::size_t i){
+			auto& status = result[i];
+			if(!status.error.empty()) return;
+
+			try{
+				auto const target = fs::path(directory) / fs::path(status.filename);
+				if(impl::tar::is_directory(typeflags[i])){
+					fs::create_directories(target);
+					return;
+				}
+
+				fs::create_directories(target.parent_path());
+
+				impl::tar::copy_entry(archive, status.offset, status.size, target.string());
+			}catch(std::exception const& error){
+				status.error = error.what();
+			}
+		});
+
+#ifdef TOOLS_TAR_EXTRACT_POSIX
+		::close(archive);
+#endif
+
+		return result;
+	}
+
+
+}
+
+
+#undef TOOLS_TAR_EXTRACT_POSIX
+
+#endif
@@ -9,25 +9,84 @@
 ///
 
 #include "rect.hpp"
+#include "bitmap_layout.hpp"
 
 #include <vector>
+#include <memory>
 #include <utility>
+#include <algorithm>
 #include <stdexcept>
 #include <sstream>
+#include <type_traits>
 
 
 namespace tools {
 
 
+	/// \brief Tag type to construct or resize a bitmap without initialization of the values
+	struct uninitialized_t{};
+
+	/// \brief Tag to construct or resize a bitmap without initialization of the values
+	///
+	/// Use it if every value is written anyway.
+	constexpr uninitialized_t uninitialized{};
+
+
+	namespace impl{ namespace bitmap{
+
+
+		/// \brief Allocator adaptor that default initializes instead of value initializes
+		template < typename Allocator >
+		class default_init_allocator: public Allocator{
+		public:
+			template < typename U >
+			struct rebind{
+				using other = default_init_allocator< typename std::allocator_traits< Allocator >::template rebind_alloc< U > >;
+			};
+
+			using Allocator::Allocator;
+
+			default_init_allocator() = default;
+
+			template < typename OtherAllocator >
+			default_init_allocator(default_init_allocator< OtherAllocator > const& other):
+				Allocator(other) {}
+
+			template < typename U >
+			void construct(U* ptr)noexcept(std::is_nothrow_default_constructible< U >::value){
+				::new(static_cast< void* >(ptr)) U;
+			}
+
+			template < typename U, typename ... Args >
+			void construct(U* ptr, Args&& ... args){
+				std::allocator_traits< Allocator >::construct(static_cast< Allocator& >(*this), ptr, std::forward< Args >(args) ...);
+			}
+		};
+
+
+	} }
+
+
 	/// \brief A bitmap for data manipulation
 	/// \tparam ValueType Type of the data that administrates the bitmap
+	/// \tparam Layout Storage policy, see tools::dense_layout and tools::aligned_layout
 	///
-	template < typename ValueType >
+	/// If the layout pads the rows, the iterators run over the padding values too.
+	/// The bitmap keeps them at value_type(), so algorithms over the whole data
+	/// see equal values for bitmaps with equal points.
+	///
+	template < typename ValueType, typename Layout = dense_layout >
 	class bitmap{
 	public:
 		/// \brief Type of the data that administrates the bitmap
 		using value_type = ValueType;
 
+		/// \brief Storage policy
+		using layout_type = Layout;
+
+		/// \brief Type of the data field
+		using container_type = std::vector< value_type, impl::bitmap::default_init_allocator< typename layout_type::template allocator< value_type > > >;
+
 		/// \brief Type of points in the bitmap
 		using point_type = tools::point< std::size_t >;
 
@@ -35,22 +94,22 @@ namespace tools {
 		using size_type = tools::size< std::size_t >;
 
 		/// \brief Type of a iterator for data
-		using iterator = typename std::vector< value_type >::iterator;
+		using iterator = typename container_type::iterator;
 
 		/// \brief Type of a iterator for const data
-		using const_iterator = typename std::vector< value_type >::const_iterator;
+		using const_iterator = typename container_type::const_iterator;
 
 		/// \brief Type of a reverse iterator for data
-		using reverse_iterator = typename std::vector< value_type >::reverse_iterator;
+		using reverse_iterator = typename container_type::reverse_iterator;
 
 		/// \brief Type of a reverse iterator for const data
-		using const_reverse_iterator = typename std::vector< value_type >::const_reverse_iterator;
+		using const_reverse_iterator = typename container_type::const_reverse_iterator;
 
 		/// \brief Type of a reference to data
-		using reference = typename std::vector< value_type >::reference;
+		using reference = typename container_type::reference;
 
 		/// \brief Type of a const reference to data
-		using const_reference = typename std::vector< value_type >::const_reference;
+		using const_reference = typename container_type::const_reference;
 
 
 
@@ -67,9 +126,24 @@ namespace tools {
 		/// \throw std::out_of_range
 		bitmap(size_type const& size, value_type const& value = value_type()):
 			size_(size),
-			data_(size_.point_count(), value)
+			row_stride_(layout_type::template row_stride< value_type >(size_.width())),
+			data_(row_stride_ * size_.height(), value)
+		{
+			throw_if_size_is_negative(size_);
+			clear_padding();
+		}
+
+		/// \brief Constructs a bitmap on position (0, 0), with size size.width and size.height, the values are not initialized
+		///
+		/// The padding of a padded layout is initialized anyway.
+		/// \throw std::out_of_range
+		bitmap(size_type const& size, uninitialized_t):
+			size_(size),
+			row_stride_(layout_type::template row_stride< value_type >(size_.width())),
+			data_(row_stride_ * size_.height())
 		{
 			throw_if_size_is_negative(size_);
+			clear_padding();
 		}
 
 		/// \brief Constructs a bitmap on position (0, 0), with size size.width and size.height, initialiese all values with value
@@ -77,6 +151,7 @@ namespace tools {
 		template < typename InputIterator >
 		bitmap(size_type const& size, InputIterator first, InputIterator last) :
 			size_(size),
+			row_stride_(layout_type::template row_stride< value_type >(size_.width())),
 			data_(first, last)
 		{
 			throw_if_size_is_negative(size_);
@@ -89,15 +164,31 @@ namespace tools {
 					") are incompatible"
 				);
 			}
+			spread_rows();
 		}
 
 		/// \brief Constructs a bitmap on position (0, 0), with size width and height, initialiese all values with value
 		/// \throw std::out_of_range
 		bitmap(std::size_t width, std::size_t height, value_type const& value = value_type()):
 			size_(width, height),
-			data_(size_.point_count(), value)
+			row_stride_(layout_type::template row_stride< value_type >(size_.width())),
+			data_(row_stride_ * size_.height(), value)
+		{
+			throw_if_size_is_negative(size_);
+			clear_padding();
+		}
+
+		/// \brief Constructs a bitmap on position (0, 0), with size width and height, the values are not initialized
+		///
+		/// The padding of a padded layout is initialized anyway.
+		/// \throw std::out_of_range
+		bitmap(std::size_t width, std::size_t height, uninitialized_t):
+			size_(width, height),
+			row_stride_(layout_type::template row_stride< value_type >(size_.width())),
+			data_(row_stride_ * size_.height())
 		{
 			throw_if_size_is_negative(size_);
+			clear_padding();
 		}
 
 
@@ -180,8 +271,28 @@ namespace tools {
 		/// \attention All pointers and iterators to the data become invalid
 		void resize(size_type const& size, value_type const& value = value_type()){
 			throw_if_size_is_negative(size);
-			data_.resize(size.point_count(), value);
+			auto const row_stride = layout_type::template row_stride< value_type >(size.width());
+			data_.resize(row_stride * size.height(), value);
+			row_stride_ = row_stride;
 			size_= size;
+			clear_padding();
+		}
+
+		/// \brief Resize the data field, new values are not initialized
+		/// \attention All pointers and iterators to the data become invalid
+		void resize(std::size_t width, std::size_t height, uninitialized_t){
+			resize(size_type(width, height), uninitialized);
+		}
+
+		/// \brief Resize the data field, new values are not initialized
+		/// \attention All pointers and iterators to the data become invalid
+		void resize(size_type const& size, uninitialized_t){
+			throw_if_size_is_negative(size);
+			auto const row_stride = layout_type::template row_stride< value_type >(size.width());
+			data_.resize(row_stride * size.height());
+			row_stride_ = row_stride;
+			size_= size;
+			clear_padding();
 		}
 
 
@@ -205,10 +316,15 @@ namespace tools {
 			return size_.width() * size_.height();
 		}
 
+		/// \brief Get the distance between two rows in values
+		std::size_t row_stride()const{
+			return row_stride_;
+		}
+
 
 		/// \brief Get a pointer to data for direct manipulation
 		value_type* data(){
-			return const_cast< value_type* >(static_cast< const bitmap< value_type >& >(*this).data());
+			return const_cast< value_type* >(static_cast< bitmap const& >(*this).data());
 		}
 
 		/// \brief Get a pointer to constant data for direct read
@@ -216,6 +332,18 @@ namespace tools {
 			return data_.empty() ? 0 : &data_[0];
 		}
 
+		/// \brief Get a pointer to the first value in row y
+		/// \attention This function performs no range protection
+		value_type* row(std::size_t y){
+			return data() + y * row_stride_;
+		}
+
+		/// \brief Get a pointer to the first constant value in row y
+		/// \attention This function performs no range protection
+		value_type const* row(std::size_t y)const{
+			return data() + y * row_stride_;
+		}
+
 
 		/// \brief Get a reference to the value by local coordinates
 		/// \throw std::out_of_range in debug build
@@ -253,7 +381,7 @@ namespace tools {
 		/// \brief Converts a lokal point in a index for direct data access
 		/// \attention This function performs no range protection
 		std::size_t data_pos(point_type const& point)const{
-			return point.y() * width() + point.x();
+			return point.y() * row_stride_ + point.x();
 		}
 
 
@@ -261,8 +389,11 @@ namespace tools {
 		/// \brief The rectangle for global position and size
 		size_type size_;
 
+		/// \brief Distance between two rows in values
+		std::size_t row_stride_ = 0;
+
 		/// \brief The data field
-		std::vector< value_type > data_;
+		container_type data_;
 
 
 		/// \brief Get a point without range protection
@@ -275,6 +406,29 @@ namespace tools {
 			return data_[data_pos(point)];
 		}
 
+		/// \brief Move the back to back rows in data_ to their padded positions
+		void spread_rows(){
+			if(row_stride_ == size_.width()) return;
+
+			data_.resize(row_stride_ * size_.height());
+			for(std::size_t y = size_.height(); y-- > 1;){
+				auto const first = data_.begin() + y * size_.width();
+				std::move_backward(first, first + size_.width(), data_.begin() + y * row_stride_ + size_.width());
+			}
+
+			clear_padding();
+		}
+
+		/// \brief Set the values behind the rows to value_type()
+		void clear_padding(){
+			if(row_stride_ == size_.width()) return;
+
+			for(std::size_t y = 0; y < size_.height(); ++y){
+				auto const row = data_.begin() + y * row_stride_;
+				std::fill(row + size_.width(), row + row_stride_, value_type());
+			}
+		}
+
 		/// \brief Throws an exception, if the point is out of range
 		void throw_if_out_of_range(point_type const&
 			#ifdef DEBUG
@@ -302,9 +456,9 @@ namespace tools {
 	};
 
 
-	template < typename ValueType >
+	template < typename ValueType, typename Layout >
 	inline
-	bool is_point_in_bitmap(bitmap< ValueType > const& image, typename bitmap< ValueType >::point_type const& point){
+	bool is_point_in_bitmap(bitmap< ValueType, Layout > const& image, typename bitmap< ValueType, Layout >::point_type const& point){
 		if(
 			point.x() <  0              ||
 			point.x() >= image.width()  ||
@@ -0,0 +1,65 @@
+/// \file tools/bitmap_layout.hpp
+/// \author Benjamin Buch (benni.buch@gmail.com)
+/// \brief Storage layout policies for tools::bitmap
+///
+/// Copyright (c) 2015 Benjamin Buch (benni dot buch at gmail dot com)
+///
+/// Distributed under the Boost Software License, Version 1.0. (See accompanying
+/// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+///
+#ifndef _tools_bitmap_layout_hpp_INCLUDED_
+#define _tools_bitmap_layout_hpp_INCLUDED_
+
+#include <boost/align/aligned_allocator.hpp>
+
+#include <memory>
+#include <cstddef>
+
+
+namespace tools {
+
+
+	/// \brief Rows are stored back to back with default alignment
+	struct dense_layout{
+		/// \brief Allocator for the data field
+		template < typename ValueType >
+		using allocator = std::allocator< ValueType >;
+
+		/// \brief Get the distance between two rows in values
+		template < typename ValueType >
+		static std::size_t row_stride(std::size_t width){
+			return width;
+		}
+	};
+
+
+	/// \brief Storage is aligned and every row is padded to a multiple of bytes
+	///
+	/// With the defaults every row starts on a 64 byte boundary, so vectorized
+	/// per-row kernels need no scalar prologue.
+	///
+	/// \tparam Alignment Alignment of the first value in bytes
+	/// \tparam RowMultiple Every row is padded to a multiple of this in bytes
+	template < std::size_t Alignment = 64, std::size_t RowMultiple = Alignment >
+	struct aligned_layout{
+		static_assert(Alignment > 0 && (Alignment & (Alignment - 1)) == 0, "Alignment must be a power of 2");
+		static_assert(RowMultiple > 0, "RowMultiple must be positive");
+
+		/// \brief Allocator for the data field
+		template < typename ValueType >
+		using allocator = boost::alignment::aligned_allocator< ValueType, Alignment >;
+
+		/// \brief Get the distance between two rows in values
+		template < typename ValueType >
+		static std::size_t row_stride(std::size_t width){
+			static_assert(RowMultiple % sizeof(ValueType) == 0, "RowMultiple must be a multiple of the value size");
+
+			std::size_t const multiple = RowMultiple / sizeof(ValueType);
+			return (width + multiple - 1) / multiple * multiple;
+		}
+	};
+
+
+}
+
+#endif
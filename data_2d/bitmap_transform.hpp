@@ -12,6 +12,9 @@
 #define _tools_bitmap_transform_hpp_INCLUDED_
 
 #include "bitmap.hpp"
+#include "bitmap_view.hpp"
+
+#include <functional>
 
 namespace tools {
 
@@ -25,9 +28,19 @@ namespace tools {
 	};
 
 	/// \brief Use a \ref simple_bitmap_transform on a bitmap, the rotation will be first executet
+	template < typename value_type_parameter, typename value_type_result, typename Layout >
+	inline tools::bitmap< value_type_result > bitmap_transform(
+		tools::bitmap< value_type_parameter, Layout > const& image,
+		simple_bitmap_transform::value transform,
+		std::function< value_type_result(value_type_parameter) > converter
+	){
+		return bitmap_transform(const_bitmap_view< value_type_parameter >(image), transform, std::move(converter));
+	}
+
+	/// \brief Use a \ref simple_bitmap_transform on a bitmap_view, the rotation will be first executet
 	template < typename value_type_parameter, typename value_type_result >
 	inline tools::bitmap< value_type_result > bitmap_transform(
-		tools::bitmap< value_type_parameter > const& image,
+		const_bitmap_view< value_type_parameter > const& image,
 		simple_bitmap_transform::value transform,
 		std::function< value_type_result(value_type_parameter) > converter
 	){
@@ -38,7 +51,8 @@ namespace tools {
 		tools::bitmap< value_type_result > result(
 			rotation ?
 			typename tools::bitmap< value_type_result >::size_type(image.height(), image.width()) :
-			image.size()
+			image.size(),
+			tools::uninitialized
 		);
 
 		for(std::size_t y = 0; y < result.height(); ++y){
@@ -0,0 +1,243 @@
+/// \file tools/bitmap_view.hpp
+/// \author Benjamin Buch (benni.buch@gmail.com)
+/// \brief Class template tools::bitmap_view
+///
+/// Copyright (c) 2015 Benjamin Buch (benni dot buch at gmail dot com)
+///
+/// Distributed under the Boost Software License, Version 1.0. (See accompanying
+/// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+///
+#ifndef _tools_bitmap_view_hpp_INCLUDED_
+#define _tools_bitmap_view_hpp_INCLUDED_
+
+#include "bitmap.hpp"
+#include "rect.hpp"
+
+#include <type_traits>
+#include <algorithm>
+#include <stdexcept>
+#include <sstream>
+
+
+namespace tools {
+
+
+	/// \brief A non-owning view to a rectangular region of bitmap data
+	///
+	/// The rows of the region are row_stride() bytes apart. A view can refer to a
+	/// tools::bitmap, a sub-rectangle of a tools::bitmap or any external memory,
+	/// for example the buffer of a camera driver. Copying a view never copies the
+	/// data.
+	///
+	/// \tparam ValueType Type of the data, use a const type for read only views
+	template < typename ValueType >
+	class bitmap_view{
+	public:
+		/// \brief Type of the data that administrates the bitmap
+		using value_type = typename std::remove_const< ValueType >::type;
+
+		/// \brief Type of points in the bitmap
+		using point_type = tools::point< std::size_t >;
+
+		/// \brief Type of bitmap size
+		using size_type = tools::size< std::size_t >;
+
+		/// \brief Type of the region of interest
+		using rect_type = tools::rect< std::size_t >;
+
+		/// \brief Type of a pointer to data
+		using pointer = ValueType*;
+
+		/// \brief Type of a reference to data
+		using reference = ValueType&;
+
+
+		/// \brief Constructs an empty view
+		bitmap_view() = default;
+
+		/// \brief Constructs a view by copying another one
+		bitmap_view(bitmap_view const&) = default;
+
+		/// \brief Constructs a view to continuous data
+		bitmap_view(pointer data, size_type const& size):
+			bitmap_view(data, size, size.width() * sizeof(value_type))
+			{}
+
+		/// \brief Constructs a view to data with rows that are row_stride bytes apart
+		/// \throw std::out_of_range
+		bitmap_view(pointer data, size_type const& size, std::size_t row_stride):
+			data_(data),
+			size_(size),
+			row_stride_(row_stride)
+		{
+			if(row_stride_ < size_.width() * sizeof(value_type)){
+				std::ostringstream os;
+				os << "tools::bitmap_view: std::out_of_range: row stride " << row_stride_ << " is smaller than a row (width = " << size_.width() << ")";
+				throw std::out_of_range(os.str());
+			}
+		}
+
+		/// \brief Constructs a view to the whole bitmap
+		template < typename Layout >
+		bitmap_view(bitmap< value_type, Layout >& image):
+			bitmap_view(image.data(), image.size(), image.row_stride() * sizeof(value_type))
+			{}
+
+		/// \brief Constructs a read only view to the whole bitmap
+		template < typename Layout, typename T = ValueType, typename = typename std::enable_if< std::is_const< T >::value >::type >
+		bitmap_view(bitmap< value_type, Layout > const& image):
+			bitmap_view(image.data(), image.size(), image.row_stride() * sizeof(value_type))
+			{}
+
+		/// \brief Constructs a view to the region roi of a bitmap
+		/// \throw std::out_of_range
+		template < typename Layout >
+		bitmap_view(bitmap< value_type, Layout >& image, rect_type const& roi):
+			bitmap_view(bitmap_view(image).subview(roi))
+			{}
+
+		/// \brief Constructs a read only view to the region roi of a bitmap
+		/// \throw std::out_of_range
+		template < typename Layout, typename T = ValueType, typename = typename std::enable_if< std::is_const< T >::value >::type >
+		bitmap_view(bitmap< value_type, Layout > const& image, rect_type const& roi):
+			bitmap_view(bitmap_view(image).subview(roi))
+			{}
+
+		/// \brief Constructs a read only view from a mutable one
+		template < typename T = ValueType, typename = typename std::enable_if< std::is_const< T >::value >::type >
+		bitmap_view(bitmap_view< value_type > const& view):
+			bitmap_view(view.data(), view.size(), view.row_stride())
+			{}
+
+
+		/// \brief Copy assignment, the data is not copied
+		bitmap_view& operator=(bitmap_view const&) = default;
+
+
+		/// \brief Get the width
+		std::size_t width()const{
+			return size_.width();
+		}
+
+		/// \brief Get the height
+		std::size_t height()const{
+			return size_.height();
+		}
+
+		/// \brief Get the size
+		size_type const size()const{
+			return size_;
+		}
+
+		/// \brief Get the number of points in the view
+		std::size_t point_count()const{
+			return size_.width() * size_.height();
+		}
+
+		/// \brief Get the distance between two rows in bytes
+		std::size_t row_stride()const{
+			return row_stride_;
+		}
+
+		/// \brief Get true, if the rows are stored without gaps
+		bool is_continuous()const{
+			return height() < 2 || row_stride_ == width() * sizeof(value_type);
+		}
+
+
+		/// \brief Get a pointer to the first value
+		pointer data()const{
+			return data_;
+		}
+
+		/// \brief Get a pointer to the first value in row y
+		/// \attention This function performs no range protection
+		pointer row(std::size_t y)const{
+			using byte_pointer = typename std::conditional<
+				std::is_const< ValueType >::value, unsigned char const*, unsigned char*
+			>::type;
+
+			return reinterpret_cast< pointer >(reinterpret_cast< byte_pointer >(data_) + y * row_stride_);
+		}
+
+
+		/// \brief Get a reference to the value by local coordinates
+		/// \throw std::out_of_range in debug build
+		reference operator()(std::size_t x, std::size_t y)const{
+			return operator()(point_type(x, y));
+		}
+
+		/// \brief Get a reference to the value by local coordinates
+		/// \throw std::out_of_range in debug build
+		reference operator()(point_type const& point)const{
+			throw_if_out_of_range(point);
+			return row(point.y())[point.x()];
+		}
+
+
+		/// \brief Get a view to the region roi of this view
+		/// \throw std::out_of_range
+		bitmap_view subview(rect_type const& roi)const{
+			if(
+				roi.x() > width()  || roi.width()  > width()  - roi.x() ||
+				roi.y() > height() || roi.height() > height() - roi.y()
+			){
+				std::ostringstream os;
+				os << "tools::bitmap_view: std::out_of_range: region(x = " << roi.x() << ", y = " << roi.y() << ", width = " << roi.width() << ", height = " << roi.height() << ") is outside the view (width = " << width() << ", height = " << height() << ")";
+				throw std::out_of_range(os.str());
+			}
+
+			return bitmap_view(row(roi.y()) + roi.x(), roi.size(), row_stride_);
+		}
+
+
+	private:
+		/// \brief Pointer to the first value
+		pointer data_ = nullptr;
+
+		/// \brief Size of the region
+		size_type size_{0, 0};
+
+		/// \brief Distance between two rows in bytes
+		std::size_t row_stride_ = 0;
+
+
+		/// \brief Throws an exception, if the point is out of range
+		void throw_if_out_of_range(point_type const&
+			#ifdef DEBUG
+			point
+			#endif
+		)const{
+			#ifdef DEBUG
+				if(point.x() >= width() || point.y() >= height()){
+					std::ostringstream os;
+					os << "tools::bitmap_view: std::out_of_range: point(x = " << point.x() << ", y = " << point.y() << ") is outside the view (width = " << width() << ", height = " << height() << ")";
+					throw std::out_of_range(os.str());
+				}
+			#endif
+		}
+	};
+
+
+	/// \brief Read only view to bitmap data
+	template < typename ValueType >
+	using const_bitmap_view = bitmap_view< ValueType const >;
+
+
+	/// \brief Copy the content of a view into a new bitmap
+	template < typename ValueType >
+	inline bitmap< typename std::remove_const< ValueType >::type > make_bitmap(bitmap_view< ValueType > const& view){
+		bitmap< typename std::remove_const< ValueType >::type > result(view.size(), uninitialized);
+
+		auto target = result.data();
+		for(std::size_t y = 0; y < view.height(); ++y){
+			target = std::copy(view.row(y), view.row(y) + view.width(), target);
+		}
+
+		return result;
+	}
+
+
+}
+
+#endif
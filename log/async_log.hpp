@@ -0,0 +1,435 @@
+/// \file tools/async_log.hpp
+/// \author Benjamin Buch (benni.buch@gmail.com)
+/// \date 2015
+/// \brief Asynchronous output for the log-System
+///
+/// Copyright (c) 2015 Benjamin Buch (benni dot buch at gmail dot com)
+///
+/// Distributed under the Boost Software License, Version 1.0. (See accompanying
+/// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+///
+
+#ifndef _tools_async_log_hpp_INCLUDED_
+#define _tools_async_log_hpp_INCLUDED_
+
+#include "log.hpp"
+
+#include <condition_variable>
+#include <algorithm>
+#include <iostream>
+#include <cstdint>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <string>
+#include <chrono>
+#include <vector>
+#include <mutex>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define TOOLS_ASYNC_LOG_POSIX
+#include <cerrno>
+#include <unistd.h>
+#include <sys/uio.h>
+#endif
+
+
+namespace tools{
+
+
+	/// \brief Behavior of async_log_backend if its queue is full
+	enum class overflow_policy{
+		/// \brief Wait until the background thread made room
+		block,
+
+		/// \brief Discard the message and count it
+		drop,
+
+		/// \brief Write the message synchronously, it may overtake queued messages
+		write_through
+	};
+
+
+	/// \brief Writes log messages on a background thread
+	///
+	/// Producers move finished messages into a bounded lock-free ring buffer.
+	/// The background thread collects all available messages and writes them
+	/// with a single writev on POSIX systems. On other systems the messages
+	/// are written to std::clog.
+	class async_log_backend{
+	public:
+		/// \brief Starts the background thread
+		///
+		/// \param capacity Count of messages in the queue, rounded up to a power of 2
+		/// \param policy Behavior if the queue is full
+		/// \param fd File descriptor for the output, ignored on non POSIX systems
+		explicit async_log_backend(
+			std::size_t capacity = 4096,
+			overflow_policy policy = overflow_policy::block,
+			int fd = 2
+		);
+
+		async_log_backend(async_log_backend const&) = delete;
+		async_log_backend& operator=(async_log_backend const&) = delete;
+
+		/// \brief Writes all queued messages and stops the background thread
+		~async_log_backend();
+
+
+		/// \brief Queue a message
+		void push(std::string&& message);
+
+		/// \brief Queue a copy of a message
+		void push(char const* data, std::size_t size);
+
+		/// \brief Waits until all messages queued before the call are written
+		void flush();
+
+		/// \brief Count of messages discarded by overflow_policy::drop
+		std::size_t dropped()const{
+			return dropped_.load(std::memory_order_relaxed);
+		}
+
+
+	private:
+		/// \brief A message in the ring buffer
+		struct slot{
+			/// \brief Position for which the slot is free or ready
+			std::atomic< std::size_t > sequence;
+
+			std::string message;
+		};
+
+		/// \brief Get a free slot or nullptr if the queue is full
+		slot* acquire(std::size_t& pos);
+
+		/// \brief Hand a filled slot to the background thread
+		void publish(slot& target, std::size_t pos);
+
+		/// \brief Handle a message that did not fit into the queue
+		void overflow(char const* data, std::size_t size);
+
+		/// \brief Write messages directly
+		void write_direct(char const* data, std::size_t size);
+
+		/// \brief Loop of the background thread
+		void run();
+
+		/// \brief Write all ready messages, get the count of written messages
+		std::size_t write_batch();
+
+
+		std::unique_ptr< slot[] > slots_;
+		std::size_t const mask_;
+		overflow_policy const policy_;
+		int const fd_;
+
+		/// \brief Next position for producers
+		alignas(64) std::atomic< std::size_t > head_;
+
+		/// \brief Next position for the background thread
+		alignas(64) std::size_t tail_ = 0;
+
+		/// \brief Count of written messages, for flush
+		std::atomic< std::size_t > written_;
+
+		std::atomic< std::size_t > dropped_;
+
+		/// \brief Count of dropped messages already reported in the output
+		std::size_t reported_dropped_ = 0;
+
+		/// \brief Set while the background thread waits for messages
+		std::atomic< bool > sleeping_;
+
+		std::atomic< bool > stop_;
+
+		std::mutex mutex_;
+		std::condition_variable wake_;
+
+		/// \brief Serializes write_direct with the background thread
+		std::mutex output_mutex_;
+
+		std::thread thread_;
+	};
+
+
+	/// \brief The backend of async_log_base
+	async_log_backend& default_async_log_backend();
+
+
+	/// \brief Output of messages by default_async_log_backend()
+	struct async_log_base{
+		static void output(boost::string_view str){
+			default_async_log_backend().push(str.data(), str.size());
+		}
+
+		static void output(std::string&& str){
+			default_async_log_backend().push(std::move(str));
+		}
+	};
+
+	/// \brief A log with asynchronous output
+	struct async_log: async_log_base, log_base{
+		using async_log_base::output;
+	};
+
+
+	//=============================================================================
+	// Implementation
+	//=============================================================================
+
+	namespace impl{ namespace async_log{
+
+
+		/// \brief Round up to the next power of 2
+		inline std::size_t ceil_power_of_2(std::size_t value){
+			std::size_t result = 1;
+			while(result < value) result <<= 1;
+			return result;
+		}
+
+
+	} }
+
+
+	inline async_log_backend::async_log_backend(std::size_t capacity, overflow_policy policy, int fd):
+		slots_(new slot[impl::async_log::ceil_power_of_2(std::max< std::size_t >(capacity, 2))]),
+		mask_(impl::async_log::ceil_power_of_2(std::max< std::size_t >(capacity, 2)) - 1),
+		policy_(policy),
+		fd_(fd),
+		head_(0),
+		written_(0),
+		dropped_(0),
+		sleeping_(false),
+		stop_(false)
+	{
+		for(std::size_t i = 0; i <= mask_; ++i){
+			slots_[i].sequence.store(i, std::memory_order_relaxed);
+		}
+
+		thread_ = std::thread([this]{ run(); });
+	}
+
+	inline async_log_backend::~async_log_backend(){
+		{
+			std::lock_guard< std::mutex > lock(mutex_);
+			stop_ = true;
+		}
+		wake_.notify_one();
+
+		thread_.join();
+	}
+
+	inline void async_log_backend::push(std::string&& message){
+		std::size_t pos;
+		if(auto target = acquire(pos)){
+			target->message = std::move(message);
+			publish(*target, pos);
+		}else{
+			overflow(message.data(), message.size());
+		}
+	}
+
+	inline void async_log_backend::push(char const* data, std::size_t size){
+		std::size_t pos;
+		if(auto target = acquire(pos)){
+			// reuses the capacity of the slot
+			target->message.assign(data, size);
+			publish(*target, pos);
+		}else{
+			overflow(data, size);
+		}
+	}
+
+	inline void async_log_backend::flush(){
+		auto const target = head_.load(std::memory_order_acquire);
+
+		for(;;){
+			{
+				std::lock_guard< std::mutex > lock(mutex_);
+			}
+			wake_.notify_one();
+
+			if(written_.load(std::memory_order_acquire) >= target) return;
+
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+	}
+
+	inline async_log_backend::slot* async_log_backend::acquire(std::size_t& pos){
+		for(;;){
+			pos = head_.load(std::memory_order_relaxed);
+
+			for(;;){
+				auto& target = slots_[pos & mask_];
+				auto const sequence = target.sequence.load(std::memory_order_acquire);
+				auto const difference = static_cast< std::intptr_t >(sequence) - static_cast< std::intptr_t >(pos);
+
+				if(difference == 0){
+					if(head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)){
+						return &target;
+					}
+				}else if(difference < 0){
+					break;
+				}else{
+					pos = head_.load(std::memory_order_relaxed);
+				}
+			}
+
+			// the queue is full
+			if(policy_ != overflow_policy::block) return nullptr;
+
+			wake_.notify_one();
+			std::this_thread::yield();
+		}
+	}
+
+	inline void async_log_backend::publish(slot& target, std::size_t pos){
+		target.sequence.store(pos + 1, std::memory_order_release);
+
+		// pairs with the fence in run, so a sleeping background thread can't miss the message
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if(sleeping_.load(std::memory_order_relaxed)){
+			{
+				std::lock_guard< std::mutex > lock(mutex_);
+			}
+			wake_.notify_one();
+		}
+	}
+
+	inline void async_log_backend::overflow(char const* data, std::size_t size){
+		if(policy_ == overflow_policy::drop){
+			dropped_.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		std::lock_guard< std::mutex > lock(output_mutex_);
+		write_direct(data, size);
+	}
+
+	inline void async_log_backend::write_direct(char const* data, std::size_t size){
+#ifdef TOOLS_ASYNC_LOG_POSIX
+		while(size > 0){
+			auto const count = ::write(fd_, data, size);
+			if(count <= 0) return;
+			data += count;
+			size -= static_cast< std::size_t >(count);
+		}
+#else
+		std::clog.write(data, size);
+		std::clog.flush();
+#endif
+	}
+
+	inline void async_log_backend::run(){
+		for(;;){
+			if(write_batch() > 0) continue;
+
+			std::unique_lock< std::mutex > lock(mutex_);
+			if(stop_) break;
+
+			sleeping_.store(true, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+
+			auto const& next = slots_[tail_ & mask_];
+			if(next.sequence.load(std::memory_order_acquire) != tail_ + 1){
+				wake_.wait_for(lock, std::chrono::milliseconds(100));
+			}
+
+			sleeping_.store(false, std::memory_order_relaxed);
+		}
+
+		// messages of producers that are still running are lost
+		while(write_batch() > 0){}
+	}
+
+	inline std::size_t async_log_backend::write_batch(){
+		static constexpr std::size_t max_batch = 64;
+
+		std::size_t count = 0;
+		while(count < max_batch){
+			auto const& next = slots_[(tail_ + count) & mask_];
+			if(next.sequence.load(std::memory_order_acquire) != tail_ + count + 1) break;
+			++count;
+		}
+
+		auto const dropped = dropped_.load(std::memory_order_relaxed);
+		if(count == 0 && dropped == reported_dropped_) return 0;
+
+		std::string notice;
+		if(dropped != reported_dropped_){
+			notice = "LOG: " + std::to_string(dropped - reported_dropped_) + " messages dropped\n";
+			reported_dropped_ = dropped;
+		}
+
+		{
+			std::lock_guard< std::mutex > lock(output_mutex_);
+
+#ifdef TOOLS_ASYNC_LOG_POSIX
+			iovec vectors[max_batch + 1];
+			std::size_t vector_count = 0;
+
+			if(!notice.empty()){
+				vectors[vector_count++] = iovec{const_cast< char* >(notice.data()), notice.size()};
+			}
+
+			for(std::size_t i = 0; i < count; ++i){
+				auto& message = slots_[(tail_ + i) & mask_].message;
+				vectors[vector_count++] = iovec{const_cast< char* >(message.data()), message.size()};
+			}
+
+			// a partial write continues behind the written bytes
+			iovec* first = vectors;
+			while(vector_count > 0){
+				auto result = ::writev(fd_, first, static_cast< int >(vector_count));
+				if(result < 0 && errno == EINTR) continue;
+				if(result < 0) break;
+
+				auto written = static_cast< std::size_t >(result);
+				while(vector_count > 0 && written >= first->iov_len){
+					written -= first->iov_len;
+					++first;
+					--vector_count;
+				}
+
+				if(vector_count > 0){
+					first->iov_base = static_cast< char* >(first->iov_base) + written;
+					first->iov_len -= written;
+				}
+			}
+#else
+			std::clog << notice;
+			for(std::size_t i = 0; i < count; ++i){
+				std::clog << slots_[(tail_ + i) & mask_].message;
+			}
+			std::clog.flush();
+#endif
+		}
+
+		for(std::size_t i = 0; i < count; ++i){
+			auto& target = slots_[tail_ & mask_];
+
+			// keep the capacity for push by copy
+			target.message.clear();
+			target.sequence.store(tail_ + mask_ + 1, std::memory_order_release);
+			++tail_;
+		}
+
+		written_.fetch_add(count, std::memory_order_release);
+
+		return count;
+	}
+
+
+	inline async_log_backend& default_async_log_backend(){
+		static async_log_backend backend;
+		return backend;
+	}
+
+
+}
+
+
+#undef TOOLS_ASYNC_LOG_POSIX
+
+#endif
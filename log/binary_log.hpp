@@ -0,0 +1,411 @@
+/// \file tools/binary_log.hpp
+/// \author Benjamin Buch (benni.buch@gmail.com)
+/// \date 2015
+/// \brief A log that records raw arguments and is rendered to text offline
+///
+/// Copyright (c) 2015 Benjamin Buch (benni dot buch at gmail dot com)
+///
+/// Distributed under the Boost Software License, Version 1.0. (See accompanying
+/// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+///
+
+#ifndef _tools_binary_log_hpp_INCLUDED_
+#define _tools_binary_log_hpp_INCLUDED_
+
+#include "thread_number.hpp"
+
+#include <boost/utility/string_view.hpp>
+
+#include <type_traits>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+
+
+/// \brief Record a binary log event
+///
+/// The first argument is the format, a string literal in which every {} is
+/// replaced by the next argument when the log is decoded. Arguments can be
+/// arithmetic types, bool, char and strings (char const*, std::string,
+/// boost::string_view).
+///
+/// Every call site gets a static descriptor with file, line, format and
+/// argument types, which is written to the log file once. An event only
+/// stores the descriptor id, timestamp, thread number and the raw bytes of
+/// the arguments into a buffer of the calling thread.
+///
+/// Example: TOOLS_BINARY_LOG("frame {} took {} ms", frame, duration);
+#define TOOLS_BINARY_LOG(...) \
+	::tools::impl::binary_log::record([](auto types)->::tools::binary_log_descriptor const&{ \
+		static ::tools::binary_log_descriptor const descriptor(__FILE__, __LINE__, types); \
+		return descriptor; \
+	}, __VA_ARGS__)
+
+
+namespace tools{
+
+
+	/// \brief Type of a recorded argument
+	enum class binary_log_type: std::uint8_t{
+		boolean,
+		character,
+		int8,
+		uint8,
+		int16,
+		uint16,
+		int32,
+		uint32,
+		int64,
+		uint64,
+		float32,
+		float64,
+		string
+	};
+
+
+	namespace impl{ namespace binary_log{
+
+
+		/// \brief Format and argument types of a call site
+		template < typename ... Args >
+		struct site_types{
+			char const* format;
+		};
+
+
+	} }
+
+
+	/// \brief Static description of a TOOLS_BINARY_LOG call site
+	struct binary_log_descriptor{
+		template < typename ... Args >
+		binary_log_descriptor(char const* file, unsigned line, impl::binary_log::site_types< Args ... > types);
+
+		binary_log_descriptor(binary_log_descriptor const&) = delete;
+		binary_log_descriptor& operator=(binary_log_descriptor const&) = delete;
+
+		char const* file;
+		std::uint32_t line;
+		char const* format;
+		std::vector< binary_log_type > types;
+
+		/// \brief Unique number of the call site
+		std::uint32_t id;
+	};
+
+
+	/// \brief Write all binary log events into a file
+	///
+	/// A previously opened file is closed. Events recorded while no file is
+	/// open are discarded.
+	///
+	/// \throw std::runtime_error if the file can't be opened
+	void open_binary_log(std::string const& filename);
+
+	/// \brief Close the binary log file
+	///
+	/// The events of the calling thread are written before. Other threads
+	/// have to call flush_binary_log() before, otherwise their buffered
+	/// events are lost.
+	void close_binary_log();
+
+	/// \brief Write the buffered events of the calling thread
+	///
+	/// This is done automatically if the buffer is full and at thread exit.
+	void flush_binary_log();
+
+
+	//=============================================================================
+	// Implementation
+	//=============================================================================
+
+	namespace impl{ namespace binary_log{
+
+
+		/// \brief Start of every binary log file
+		constexpr char magic[8] = {'t', 'o', 'o', 'l', 's', 'l', 'o', 'g'};
+
+		/// \brief Kind of a record in the file
+		///
+		/// A record is the kind (1 byte), the size of the payload (4 byte) and
+		/// the payload. All numbers are in native byte order.
+		enum class record_kind: std::uint8_t{
+			descriptor = 1,
+			events = 2
+		};
+
+		/// \brief Size of an event without arguments: id, timestamp, thread number
+		constexpr std::size_t event_header_size = 4 + 8 + 4;
+
+
+		template < typename T, typename = void >
+		struct arg_traits{
+			static_assert(sizeof(T) == 0, "type is not supported by TOOLS_BINARY_LOG");
+		};
+
+		/// \brief Integer types are stored by size and signedness
+		template < typename T >
+		struct arg_traits< T, typename std::enable_if< std::is_integral< T >::value >::type >{
+			static constexpr binary_log_type type =
+				std::is_same< T, bool >::value ? binary_log_type::boolean :
+				std::is_same< T, char >::value ? binary_log_type::character :
+				sizeof(T) == 1 ? (std::is_signed< T >::value ? binary_log_type::int8 : binary_log_type::uint8) :
+				sizeof(T) == 2 ? (std::is_signed< T >::value ? binary_log_type::int16 : binary_log_type::uint16) :
+				sizeof(T) == 4 ? (std::is_signed< T >::value ? binary_log_type::int32 : binary_log_type::uint32) :
+				(std::is_signed< T >::value ? binary_log_type::int64 : binary_log_type::uint64);
+
+			static_assert(sizeof(T) <= 8, "integer type is too large for TOOLS_BINARY_LOG");
+
+			static std::size_t size(T){
+				return sizeof(T);
+			}
+
+			static char* write(char* target, T value){
+				std::memcpy(target, &value, sizeof(T));
+				return target + sizeof(T);
+			}
+		};
+
+		/// \brief float is stored as float, all other floating point types as double
+		template < typename T >
+		struct arg_traits< T, typename std::enable_if< std::is_floating_point< T >::value >::type >{
+			using stored = typename std::conditional< std::is_same< T, float >::value, float, double >::type;
+
+			static constexpr binary_log_type type =
+				std::is_same< T, float >::value ? binary_log_type::float32 : binary_log_type::float64;
+
+			static std::size_t size(T){
+				return sizeof(stored);
+			}
+
+			static char* write(char* target, T value){
+				stored const converted = static_cast< stored >(value);
+				std::memcpy(target, &converted, sizeof(stored));
+				return target + sizeof(stored);
+			}
+		};
+
+		/// \brief Strings are stored as 4 byte length and characters
+		struct string_traits{
+			static constexpr binary_log_type type = binary_log_type::string;
+
+			static std::size_t size(boost::string_view value){
+				return 4 + value.size();
+			}
+
+			static char* write(char* target, boost::string_view value){
+				std::uint32_t const length = static_cast< std::uint32_t >(value.size());
+				std::memcpy(target, &length, 4);
+				std::memcpy(target + 4, value.data(), value.size());
+				return target + 4 + value.size();
+			}
+		};
+
+		template <> struct arg_traits< char const* >: string_traits{};
+		template <> struct arg_traits< char* >: string_traits{};
+		template <> struct arg_traits< std::string >: string_traits{};
+		template <> struct arg_traits< boost::string_view >: string_traits{};
+
+		template < typename T >
+		using arg_traits_t = arg_traits< typename std::decay< T >::type >;
+
+
+		/// \brief The open file and all descriptors
+		struct log_state{
+			std::mutex mutex;
+			std::ofstream file;
+			std::vector< binary_log_descriptor const* > descriptors;
+
+			/// \brief true while a file is open, checked before recording
+			std::atomic< bool > active{false};
+		};
+
+		inline log_state& state(){
+			static log_state value;
+			return value;
+		}
+
+		/// \brief Write a record, the state must be locked
+		inline void write_record(log_state& state, record_kind kind, char const* data, std::size_t size){
+			auto const kind_byte = static_cast< std::uint8_t >(kind);
+			auto const size_bytes = static_cast< std::uint32_t >(size);
+			state.file.write(reinterpret_cast< char const* >(&kind_byte), 1);
+			state.file.write(reinterpret_cast< char const* >(&size_bytes), 4);
+			state.file.write(data, static_cast< std::streamsize >(size));
+		}
+
+		inline void append_u32(std::string& target, std::uint32_t value){
+			target.append(reinterpret_cast< char const* >(&value), 4);
+		}
+
+		/// \brief Write a descriptor record, the state must be locked
+		inline void write_descriptor(log_state& state, binary_log_descriptor const& descriptor){
+			std::string payload;
+			append_u32(payload, descriptor.id);
+			append_u32(payload, descriptor.line);
+			append_u32(payload, static_cast< std::uint32_t >(descriptor.types.size()));
+			for(auto type: descriptor.types) payload += static_cast< char >(type);
+
+			boost::string_view const file(descriptor.file);
+			append_u32(payload, static_cast< std::uint32_t >(file.size()));
+			payload.append(file.data(), file.size());
+
+			boost::string_view const format(descriptor.format);
+			append_u32(payload, static_cast< std::uint32_t >(format.size()));
+			payload.append(format.data(), format.size());
+
+			write_record(state, record_kind::descriptor, payload.data(), payload.size());
+		}
+
+		/// \brief Events of a thread, written to the file if full and at thread exit
+		class thread_buffer{
+		public:
+			static constexpr std::size_t capacity = 64 * 1024;
+
+			thread_buffer(): data_(capacity), size_(0) {}
+
+			~thread_buffer(){
+				flush();
+			}
+
+			/// \brief Get memory for an event of size bytes
+			char* reserve(std::size_t size){
+				if(size_ + size > data_.size()){
+					flush();
+					if(size > data_.size()) data_.resize(size);
+				}
+
+				auto const result = data_.data() + size_;
+				size_ += size;
+				return result;
+			}
+
+			void flush(){
+				if(size_ == 0) return;
+
+				auto& log = state();
+				std::lock_guard< std::mutex > lock(log.mutex);
+				if(log.file.is_open()){
+					write_record(log, record_kind::events, data_.data(), size_);
+					log.file.flush();
+				}
+
+				size_ = 0;
+			}
+
+		private:
+			std::vector< char > data_;
+			std::size_t size_;
+		};
+
+		inline thread_buffer& local_buffer(){
+			thread_local thread_buffer buffer;
+			return buffer;
+		}
+
+
+		inline std::size_t args_size(){
+			return 0;
+		}
+
+		template < typename T, typename ... Args >
+		std::size_t args_size(T const& value, Args const& ... args){
+			return arg_traits_t< T >::size(value) + args_size(args ...);
+		}
+
+		inline char* write_args(char* target){
+			return target;
+		}
+
+		template < typename T, typename ... Args >
+		char* write_args(char* target, T const& value, Args const& ... args){
+			return write_args(arg_traits_t< T >::write(target, value), args ...);
+		}
+
+
+		template < typename Site, std::size_t N, typename ... Args >
+		inline void record(Site const& site, char const (&format)[N], Args const& ... args){
+			if(!state().active.load(std::memory_order_relaxed)) return;
+
+			auto const& descriptor = site(site_types< typename std::decay< Args >::type ... >{format});
+
+			auto const timestamp = static_cast< std::int64_t >(std::chrono::duration_cast< std::chrono::nanoseconds >(
+				std::chrono::system_clock::now().time_since_epoch()
+			).count());
+			auto const thread = static_cast< std::uint32_t >(tools::thread_number());
+
+			auto target = local_buffer().reserve(event_header_size + args_size(args ...));
+			std::memcpy(target, &descriptor.id, 4);
+			std::memcpy(target + 4, &timestamp, 8);
+			std::memcpy(target + 12, &thread, 4);
+			write_args(target + event_header_size, args ...);
+		}
+
+
+	} }
+
+
+	template < typename ... Args >
+	binary_log_descriptor::binary_log_descriptor(
+		char const* file, unsigned line, impl::binary_log::site_types< Args ... > types
+	):
+		file(file),
+		line(line),
+		format(types.format),
+		types{impl::binary_log::arg_traits_t< Args >::type ...}
+	{
+		auto& log = impl::binary_log::state();
+		std::lock_guard< std::mutex > lock(log.mutex);
+
+		id = static_cast< std::uint32_t >(log.descriptors.size());
+		log.descriptors.push_back(this);
+
+		// the file has to know the descriptor before any of its events
+		if(log.file.is_open()) impl::binary_log::write_descriptor(log, *this);
+	}
+
+
+	inline void open_binary_log(std::string const& filename){
+		close_binary_log();
+
+		auto& log = impl::binary_log::state();
+		std::lock_guard< std::mutex > lock(log.mutex);
+
+		log.file.open(filename.c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+		if(!log.file.is_open()){
+			throw std::runtime_error("Can't open binary log file: " + filename);
+		}
+
+		log.file.write(impl::binary_log::magic, sizeof(impl::binary_log::magic));
+		for(auto descriptor: log.descriptors){
+			impl::binary_log::write_descriptor(log, *descriptor);
+		}
+
+		log.active = true;
+	}
+
+	inline void close_binary_log(){
+		flush_binary_log();
+
+		auto& log = impl::binary_log::state();
+		std::lock_guard< std::mutex > lock(log.mutex);
+
+		log.active = false;
+		if(log.file.is_open()) log.file.close();
+	}
+
+	inline void flush_binary_log(){
+		impl::binary_log::local_buffer().flush();
+	}
+
+
+}
+
+
+#endif
@@ -0,0 +1,281 @@
+/// \file tools/binary_log_decoder.hpp
+/// \author Benjamin Buch (benni.buch@gmail.com)
+/// \date 2015
+/// \brief Render files of tools/binary_log.hpp as text
+///
+/// Copyright (c) 2015 Benjamin Buch (benni dot buch at gmail dot com)
+///
+/// Distributed under the Boost Software License, Version 1.0. (See accompanying
+/// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+///
+
+#ifndef _tools_binary_log_decoder_hpp_INCLUDED_
+#define _tools_binary_log_decoder_hpp_INCLUDED_
+
+#include "binary_log.hpp"
+#include "time_to_string.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <chrono>
+
+
+namespace tools{
+
+
+	/// \brief Render a binary log as text
+	///
+	/// Every event gets a line with time, thread number, file:line and the
+	/// format with its {} replaced by the arguments. The events are written in
+	/// file order, which is sorted per thread only. The time at the start of
+	/// the line allows a global sort.
+	///
+	/// The log must have been written on a machine with the same byte order.
+	///
+	/// \throw std::runtime_error if the log is corrupt
+	void decode_binary_log(std::istream& is, std::ostream& os);
+
+	/// \brief Render a binary log file as text
+	/// \throw std::runtime_error if the file can't be opened or is corrupt
+	void decode_binary_log(std::string const& filename, std::ostream& os);
+
+
+	//=============================================================================
+	// Implementation
+	//=============================================================================
+
+	namespace impl{ namespace binary_log{
+
+
+		/// \brief A descriptor as read from a file
+		struct decoded_descriptor{
+			bool valid = false;
+			std::uint32_t line;
+			std::vector< binary_log_type > types;
+			std::string file;
+			std::string format;
+		};
+
+		/// \brief Reads values from the payload of a record
+		class payload_reader{
+		public:
+			payload_reader(char const* data, std::size_t size):
+				pos_(data), end_(data + size) {}
+
+			bool empty()const{
+				return pos_ == end_;
+			}
+
+			template < typename T >
+			T read(){
+				T result;
+				std::memcpy(&result, take(sizeof(T)), sizeof(T));
+				return result;
+			}
+
+			boost::string_view read_string(){
+				auto const size = read< std::uint32_t >();
+				return boost::string_view(take(size), size);
+			}
+
+		private:
+			char const* take(std::size_t size){
+				if(static_cast< std::size_t >(end_ - pos_) < size){
+					throw std::runtime_error("Binary log: corrupt record");
+				}
+
+				auto const result = pos_;
+				pos_ += size;
+				return result;
+			}
+
+			char const* pos_;
+			char const* end_;
+		};
+
+		/// \brief Render a single argument
+		inline void render_arg(std::ostream& os, payload_reader& reader, binary_log_type type){
+			switch(type){
+				case binary_log_type::boolean:   os << (reader.read< std::uint8_t >() != 0 ? "true" : "false"); return;
+				case binary_log_type::character: os << reader.read< char >(); return;
+				case binary_log_type::int8:      os << static_cast< int >(reader.read< std::int8_t >()); return;
+				case binary_log_type::uint8:     os << static_cast< unsigned >(reader.read< std::uint8_t >()); return;
+				case binary_log_type::int16:     os << reader.read< std::int16_t >(); return;
+				case binary_log_type::uint16:    os << reader.read< std::uint16_t >(); return;
+				case binary_log_type::int32:     os << reader.read< std::int32_t >(); return;
+				case binary_log_type::uint32:    os << reader.read< std::uint32_t >(); return;
+				case binary_log_type::int64:     os << reader.read< std::int64_t >(); return;
+				case binary_log_type::uint64:    os << reader.read< std::uint64_t >(); return;
+				case binary_log_type::float32:   os << reader.read< float >(); return;
+				case binary_log_type::float64:   os << reader.read< double >(); return;
+				case binary_log_type::string:{
+					auto const value = reader.read_string();
+					os.write(value.data(), static_cast< std::streamsize >(value.size()));
+				} return;
+			}
+
+			throw std::runtime_error("Binary log: unknown argument type");
+		}
+
+		/// \brief Descriptor ids are dense, a larger jump means a corrupt file
+		constexpr std::uint32_t max_descriptor_gap = 65536;
+
+		/// \brief Read size bytes into payload
+		///
+		/// The memory grows in chunks as the data arrives, so a corrupt size
+		/// can't cause a huge allocation.
+		inline void read_payload(std::istream& is, std::vector< char >& payload, std::uint32_t size){
+			constexpr std::size_t chunk_size = 64 * 1024;
+
+			payload.clear();
+			while(payload.size() < size){
+				auto const pos = payload.size();
+				auto const count = std::min< std::size_t >(size - pos, chunk_size);
+				payload.resize(pos + count);
+				is.read(payload.data() + pos, static_cast< std::streamsize >(count));
+				if(!is){
+					throw std::runtime_error("Binary log: truncated record");
+				}
+			}
+		}
+
+		/// \brief Render all events of an events record
+		inline void render_events(
+			std::ostream& os, payload_reader& reader, std::vector< decoded_descriptor > const& descriptors
+		){
+			while(!reader.empty()){
+				auto const id = reader.read< std::uint32_t >();
+				auto const timestamp = reader.read< std::int64_t >();
+				auto const thread = reader.read< std::uint32_t >();
+
+				if(id >= descriptors.size() || !descriptors[id].valid){
+					throw std::runtime_error("Binary log: event without descriptor");
+				}
+
+				auto const& descriptor = descriptors[id];
+
+				std::chrono::system_clock::time_point const time(
+					std::chrono::duration_cast< std::chrono::system_clock::duration >(std::chrono::nanoseconds(timestamp))
+				);
+
+				time_to_string(os, time);
+				os << ' ' << std::setfill('0') << std::setw(4) << thread << ' '
+					<< descriptor.file << ':' << descriptor.line << ' ';
+
+				// reset the state of time_to_string
+				os << std::defaultfloat << std::setfill(' ');
+
+				std::size_t arg = 0;
+				auto const& format = descriptor.format;
+				for(std::size_t i = 0; i < format.size(); ++i){
+					if(format[i] == '{' && i + 1 < format.size() && format[i + 1] == '}' && arg < descriptor.types.size()){
+						render_arg(os, reader, descriptor.types[arg++]);
+						++i;
+					}else{
+						os << format[i];
+					}
+				}
+
+				// arguments without placeholder
+				for(; arg < descriptor.types.size(); ++arg){
+					os << ' ';
+					render_arg(os, reader, descriptor.types[arg]);
+				}
+
+				os << '\n';
+			}
+		}
+
+
+	} }
+
+
+	inline void decode_binary_log(std::istream& is, std::ostream& os){
+		using namespace impl::binary_log;
+
+		char file_magic[sizeof(magic)];
+		is.read(file_magic, sizeof(file_magic));
+		if(!is || !std::equal(file_magic, file_magic + sizeof(file_magic), magic)){
+			throw std::runtime_error("Binary log: wrong magic");
+		}
+
+		std::vector< decoded_descriptor > descriptors;
+		std::vector< char > payload;
+
+		for(;;){
+			std::uint8_t kind;
+			std::uint32_t size;
+
+			is.read(reinterpret_cast< char* >(&kind), 1);
+			if(is.eof()) return;
+
+			is.read(reinterpret_cast< char* >(&size), 4);
+			if(!is){
+				throw std::runtime_error("Binary log: truncated record");
+			}
+
+			read_payload(is, payload, size);
+
+			payload_reader reader(payload.data(), payload.size());
+
+			switch(static_cast< record_kind >(kind)){
+				case record_kind::descriptor:{
+					auto const id = reader.read< std::uint32_t >();
+					if(id >= descriptors.size()){
+						if(id - descriptors.size() > max_descriptor_gap){
+							throw std::runtime_error("Binary log: corrupt record");
+						}
+						descriptors.resize(std::size_t(id) + 1);
+					}
+
+					auto& descriptor = descriptors[id];
+					descriptor.line = reader.read< std::uint32_t >();
+
+					auto const count = reader.read< std::uint32_t >();
+					descriptor.types.clear();
+					for(std::uint32_t i = 0; i < count; ++i){
+						descriptor.types.push_back(static_cast< binary_log_type >(reader.read< std::uint8_t >()));
+					}
+
+					auto const file = reader.read_string();
+					descriptor.file.assign(file.data(), file.size());
+
+					auto const format = reader.read_string();
+					descriptor.format.assign(format.data(), format.size());
+
+					descriptor.valid = true;
+				} break;
+				case record_kind::events:
+					render_events(os, reader, descriptors);
+				break;
+				default:
+					throw std::runtime_error("Binary log: unknown record kind");
+			}
+		}
+	}
+
+	inline void decode_binary_log(std::string const& filename, std::ostream& os){
+		std::ifstream is(filename.c_str(), std::ios_base::in | std::ios_base::binary);
+		if(!is.is_open()){
+			throw std::runtime_error("Can't open binary log file: " + filename);
+		}
+
+		try{
+			decode_binary_log(is, os);
+		}catch(std::runtime_error const& error){
+			throw std::runtime_error(std::string(error.what()) + ": " + filename);
+		}
+	}
+
+
+}
+
+
+#endif
@@ -88,8 +88,8 @@ namespace tools{
 
 		template < typename Log, typename Function >
 		inline void exec_log(Log& log, Function& f, std::string const& error_text){
-			std::ostringstream os;
-			os << std::boolalpha;
+			impl::log::stream_lease lease;
+			auto& os = lease.os();
 			set_os(log, os);
 			log.first(os);
 			impl::log::do_init(log);
@@ -98,7 +98,7 @@ namespace tools{
 			log.postfix(os);
 			impl::log::get_os(log) << error_text;
 			log.delimiter(os);
-			log.output(impl::log::get_os(log).str());
+			impl::log::do_output(log, lease.view());
 		}
 
 
@@ -2,11 +2,9 @@
 #define _tools_hierarchic_log_hpp_INCLUDED_
 
 #include "log.hpp"
+#include "thread_number.hpp"
 
-#include <thread>
-#include <atomic>
 #include <vector>
-#include <unordered_map>
 
 
 namespace tools{
@@ -20,12 +18,15 @@ namespace tools{
 			return value;
 		}
 
-		inline std::vector< std::size_t > add_version(){
+		/// \brief Count the new entry and open its level
+		///
+		/// \return Count of levels of the version of the new entry
+		inline std::size_t add_version(){
 			std::vector< std::size_t >& stack = version_stack();
 
 			++stack.back();
 
-			auto result = stack;
+			auto result = stack.size();
 			stack.push_back(0);
 
 			return result;
@@ -36,33 +37,28 @@ namespace tools{
 			stack.pop_back();
 		}
 
-		inline std::size_t get_thread_number(std::thread::id id){
-			static std::atomic_size_t counter(0);
-			static std::unordered_map< std::thread::id, std::size_t > table;
-			auto iter = table.find(id);
-			if(iter == table.end()) return table[id] = counter++;
-			return iter->second;
-		}
-
 
 	} }
 
 
 	struct hierarchic_log_base{
-		hierarchic_log_base(): version(impl::hierarchic_log::add_version()) {}
+		hierarchic_log_base(): version_size(impl::hierarchic_log::add_version()) {}
 		~hierarchic_log_base(){ impl::hierarchic_log::erase_version(); }
 
-		void first(std::ostringstream& os)const{
-			os << std::setfill('0') << std::setw(4) << impl::hierarchic_log::get_thread_number(std::this_thread::get_id()) << ":";
+		void first(std::ostream& os)const{
+			os << std::setfill('0') << std::setw(4) << thread_number() << ":";
 		}
 
-		void prefix(std::ostringstream& os)const{
-			if(version.size() > 0) os << version[0];
-			for(std::size_t i = 1; i < version.size(); ++i) os << '.' << version[i];
+		void prefix(std::ostream& os)const{
+			// the levels of the version are unchanged until the destructor
+			auto const& version = impl::hierarchic_log::version_stack();
+			if(version_size > 0) os << version[0];
+			for(std::size_t i = 1; i < version_size; ++i) os << '.' << version[i];
 			os << ' ';
 		}
 
-		std::vector< std::size_t > version;
+		/// \brief Count of levels of the version on the version stack
+		std::size_t version_size;
 	};
 
 	struct hierarchic_log: hierarchic_log_base, log_base{
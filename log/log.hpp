@@ -12,16 +12,72 @@
 #ifndef _tools_log_hpp_INCLUDED_
 #define _tools_log_hpp_INCLUDED_
 
+#include <boost/utility/string_view.hpp>
+
+#include <type_traits>
+#include <algorithm>
 #include <functional>
+#include <streambuf>
 #include <iostream>
 #include <iomanip>
 #include <sstream>
+#include <cstring>
+#include <memory>
+#include <vector>
 #include <atomic>
+#include <array>
+
+
+/// \brief Logs with a lower level are removed at compile time
+///
+/// The value is the number of a tools::log_level. Default is info with
+/// NDEBUG and trace otherwise.
+#ifndef TOOLS_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define TOOLS_LOG_MIN_LEVEL 2
+#else
+#define TOOLS_LOG_MIN_LEVEL 0
+#endif
+#endif
 
 
 namespace tools{
 
 
+	/// \brief Severity of a log
+	enum class log_level{
+		trace = 0,
+		debug = 1,
+		info = 2,
+		warning = 3,
+		error = 4,
+		fatal = 5
+	};
+
+	/// \brief Enable or disable all logs of a level at runtime, all levels are enabled by default
+	void set_log_level_enabled(log_level level, bool enabled);
+
+	/// \brief Enable all logs of level and above, disable all below
+	void set_min_log_level(log_level level);
+
+	/// \brief true if logs of the level are enabled at runtime
+	bool log_level_enabled(log_level level);
+
+
+	/// \brief A Log with a severity level
+	///
+	/// Logs with a level below TOOLS_LOG_MIN_LEVEL compile to nothing. Logs
+	/// with a level disabled at runtime don't construct their Log object.
+	/// Logs without level are always enabled.
+	template < log_level Level, typename Log >
+	struct leveled_log: Log{
+		static constexpr log_level level = Level;
+	};
+
+	template < log_level Level, typename Log >
+	constexpr log_level leveled_log< Level, Log >::level;
+
+
 	class log_base;
 
 	namespace impl{ namespace log{
@@ -37,6 +93,136 @@ namespace tools{
 		std::size_t get_id(log_base& log);
 
 
+		/// \brief Output buffer that keeps its memory for the next message
+		class message_buffer: public std::streambuf{
+		public:
+			message_buffer(): data_(256){
+				clear();
+			}
+
+			message_buffer(message_buffer const&) = delete;
+			message_buffer& operator=(message_buffer const&) = delete;
+
+			void clear(){
+				setp(data_.data(), data_.data() + data_.size());
+			}
+
+			boost::string_view view()const{
+				return boost::string_view(pbase(), static_cast< std::size_t >(pptr() - pbase()));
+			}
+
+		protected:
+			int_type overflow(int_type c)override{
+				if(traits_type::eq_int_type(c, traits_type::eof())) return traits_type::not_eof(c);
+
+				reserve(1);
+				*pptr() = traits_type::to_char_type(c);
+				pbump(1);
+				return c;
+			}
+
+			std::streamsize xsputn(char const* data, std::streamsize count)override{
+				reserve(static_cast< std::size_t >(count));
+				std::memcpy(pptr(), data, static_cast< std::size_t >(count));
+				pbump(static_cast< int >(count));
+				return count;
+			}
+
+		private:
+			void reserve(std::size_t count){
+				auto const size = static_cast< std::size_t >(pptr() - pbase());
+				if(size + count <= data_.size()) return;
+
+				data_.resize(std::max(data_.size() * 2, size + count));
+				setp(data_.data(), data_.data() + data_.size());
+				pbump(static_cast< int >(size));
+			}
+
+			std::vector< char > data_;
+		};
+
+		/// \brief A formatting stream that is reused by all messages of a thread
+		///
+		/// The stream is a std::ostringstream, so Log hooks that take a
+		/// std::ostringstream& keep working, but it writes into buffer. Its
+		/// str() is always empty.
+		struct message_stream{
+			message_stream(){
+				static_cast< std::ostream& >(os).rdbuf(&buffer);
+			}
+
+			message_buffer buffer;
+			std::ostringstream os;
+		};
+
+		/// \brief Lends a cleared message_stream of the current thread
+		///
+		/// A message formatted while another one is formatted (by a log inside
+		/// of a log lambda) gets its own stream.
+		class stream_lease{
+		public:
+			stream_lease(){
+				auto& pool = pool_();
+				auto& depth = depth_();
+				if(pool.size() == depth) pool.emplace_back(new message_stream);
+
+				stream_ = pool[depth++].get();
+				stream_->buffer.clear();
+				stream_->os.clear();
+				stream_->os.flags(std::ios_base::skipws | std::ios_base::dec | std::ios_base::boolalpha);
+				stream_->os.fill(' ');
+				stream_->os.precision(6);
+				stream_->os.width(0);
+			}
+
+			stream_lease(stream_lease const&) = delete;
+			stream_lease& operator=(stream_lease const&) = delete;
+
+			~stream_lease(){
+				--depth_();
+			}
+
+			std::ostringstream& os(){
+				return stream_->os;
+			}
+
+			boost::string_view view()const{
+				return stream_->buffer.view();
+			}
+
+		private:
+			static std::vector< std::unique_ptr< message_stream > >& pool_(){
+				thread_local std::vector< std::unique_ptr< message_stream > > pool;
+				return pool;
+			}
+
+			static std::size_t& depth_(){
+				thread_local std::size_t depth = 0;
+				return depth;
+			}
+
+			message_stream* stream_;
+		};
+
+
+		/// \brief Call Log::output with a string_view if it accepts one
+		template < typename Log >
+		auto do_output(Log& log, boost::string_view str, int) -> decltype(log.output(str), void()){
+			log.output(str);
+		}
+
+		/// \brief Call Log::output with a std::string
+		template < typename Log >
+		void do_output(Log& log, boost::string_view str, long){
+			log.output(std::string(str.data(), str.size()));
+		}
+
+		template < typename Log >
+		void do_output(Log& log, boost::string_view str){
+			do_output(log, str, 0);
+		}
+
+
 		template < typename Lambda >
 		struct extract_log_from_lambda {};
 
@@ -67,18 +253,27 @@ namespace tools{
 			return true;
 		}
 
-		static void first(std::ostringstream& os){}
+		/// \brief Hooks of a Log get the formatting stream
+		///
+		/// A Log may declare them with std::ostream& or std::ostringstream&,
+		/// but must not use str() of the stream.
+		static void first(std::ostream& os){}
 
-		static void prefix(std::ostringstream& os){}
+		static void prefix(std::ostream& os){}
 
-		static void postfix(std::ostringstream& os){}
+		static void postfix(std::ostream& os){}
 
-		static void delimiter(std::ostringstream& os){
+		static void delimiter(std::ostream& os){
 			os << '\n';
 		}
 
-		static void output(std::string&& str){
-			std::clog << str << std::flush;
+		/// \brief Output of a complete message
+		///
+		/// A Log may define output(boost::string_view) or output(std::string&&),
+		/// the string_view variant avoids a copy of the message.
+		static void output(boost::string_view str){
+			std::clog.write(str.data(), static_cast< std::streamsize >(str.size()));
+			std::clog.flush();
 		}
 
 	protected:
@@ -129,15 +324,15 @@ namespace tools{
 			get_os(log) << std::setfill('0') << std::setw(6) << get_id(log) << ' ';
 		}
 
-		inline void do_exception(std::ostringstream& os){
+		inline void do_exception(std::ostream& os){
 			os << " (failed by exception)";
 		}
 
 
 		template < typename Log, typename Function >
 		inline void exec_log(Log& log, Function& f){
-			std::ostringstream os;
-			os << std::boolalpha;
+			stream_lease lease;
+			auto& os = lease.os();
 			set_os(log, os);
 
 			log.first(os);
@@ -146,13 +341,13 @@ namespace tools{
 			f(log);
 			log.postfix(os);
 			log.delimiter(os);
-			log.output(get_os(log).str());
+			do_output(log, lease.view());
 		}
 
 		template < typename Log, typename Function >
 		inline void exec_log(Log& log, Function& f, bool exception){
-			std::ostringstream os;
-			os << std::boolalpha;
+			stream_lease lease;
+			auto& os = lease.os();
 			set_os(log, os);
 
 			log.first(os);
@@ -162,7 +357,7 @@ namespace tools{
 			log.postfix(os);
 			if(exception) do_exception(get_os(log));
 			log.delimiter(os);
-			log.output(get_os(log).str());
+			do_output(log, lease.view());
 		}
 
 		auto const error_message = "FATAL ERROR: Exception while writing a log message!";
@@ -236,6 +431,80 @@ namespace tools{
 		}
 
 
+		inline std::array< std::atomic< bool >, 6 >& level_switches(){
+			static std::array< std::atomic< bool >, 6 > switches{{{true}, {true}, {true}, {true}, {true}, {true}}};
+			return switches;
+		}
+
+		template < typename ... T >
+		struct make_void{
+			using type = void;
+		};
+
+		/// \brief false if the level of Log is below TOOLS_LOG_MIN_LEVEL
+		template < typename Log, typename = void >
+		struct compiled_in: std::true_type{};
+
+		template < typename Log >
+		struct compiled_in< Log, typename make_void< decltype(Log::level) >::type >:
+			std::integral_constant< bool, static_cast< int >(Log::level) >= TOOLS_LOG_MIN_LEVEL >{};
+
+		/// \brief Runtime switch of the level of Log
+		template < typename Log >
+		auto level_active(int) -> decltype(Log::level, bool()){
+			return log_level_enabled(Log::level);
+		}
+
+		/// \brief Logs without level are always active
+		template < typename Log >
+		bool level_active(long){
+			return true;
+		}
+
+		/// \brief Log::is_active() if it is a static member function
+		template < typename Log >
+		auto static_active(int) -> decltype(bool(Log::is_active())){
+			return Log::is_active();
+		}
+
+		/// \brief is_active() is only known after construction
+		template < typename Log >
+		bool static_active(long){
+			return true;
+		}
+
+
+		template < typename Log, typename F >
+		inline void log_if(F&& f, std::false_type){
+			check_log_type< Log, F >();
+		}
+
+		template < typename Log, typename F >
+		inline void log_if(F&& f, std::true_type){
+			// inactive logs don't construct their state
+			if(!level_active< Log >(0) || !static_active< Log >(0)) return;
+
+			Log log;
+			impl::log::log(log, std::forward< F >(f));
+		}
+
+		template < typename Log, typename F, typename Body >
+		inline auto log_if(F&& f, Body&& body, std::false_type) -> decltype(body()){
+			check_log_type< Log, F >();
+
+			return body();
+		}
+
+		template < typename Log, typename F, typename Body >
+		inline auto log_if(F&& f, Body&& body, std::true_type) -> decltype(body()){
+			// is_active() is checked later, a failed body is logged anyway
+			if(!level_active< Log >(0)) return body();
+
+			Log log;
+			return impl::log::log(log, std::forward< F >(f), std::forward< Body >(body));
+		}
+
+
 	} }
 
 
@@ -243,16 +512,31 @@ namespace tools{
 	inline void log(F&& f){
 		using Log = impl::log::extract_log_t< F >;
 
-		Log log;
-		impl::log::log(log, std::forward< F >(f));
+		impl::log::log_if< Log >(std::forward< F >(f), impl::log::compiled_in< Log >());
 	}
 
 	template < typename F, typename Body >
 	inline auto log(F&& f, Body&& body) -> decltype(body()){
 		using Log = impl::log::extract_log_t< F >;
 
-		Log log;
-		return impl::log::log(log, std::forward< F >(f), std::forward< Body >(body));
+		return impl::log::log_if< Log >(
+			std::forward< F >(f), std::forward< Body >(body), impl::log::compiled_in< Log >()
+		);
+	}
+
+
+	inline void set_log_level_enabled(log_level level, bool enabled){
+		impl::log::level_switches()[static_cast< std::size_t >(level)].store(enabled, std::memory_order_relaxed);
+	}
+
+	inline void set_min_log_level(log_level level){
+		for(std::size_t i = 0; i < impl::log::level_switches().size(); ++i){
+			set_log_level_enabled(static_cast< log_level >(i), i >= static_cast< std::size_t >(level));
+		}
+	}
+
+	inline bool log_level_enabled(log_level level){
+		return impl::log::level_switches()[static_cast< std::size_t >(level)].load(std::memory_order_relaxed);
 	}
 
 
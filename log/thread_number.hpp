@@ -0,0 +1,94 @@
+/// \file tools/thread_number.hpp
+/// \author Benjamin Buch (benni.buch@gmail.com)
+/// \date 2015
+/// \brief Small numbers and optional names for threads in logs
+///
+/// Copyright (c) 2015 Benjamin Buch (benni dot buch at gmail dot com)
+///
+/// Distributed under the Boost Software License, Version 1.0. (See accompanying
+/// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+///
+
+#ifndef _tools_thread_number_hpp_INCLUDED_
+#define _tools_thread_number_hpp_INCLUDED_
+
+#include <atomic>
+#include <string>
+#include <mutex>
+#include <map>
+
+
+namespace tools{
+
+
+	/// \brief Number of the calling thread
+	///
+	/// Threads are numbered from 0 in the order of their first call. The
+	/// number is cached thread locally, so only the first call of a thread
+	/// touches shared state (a single atomic increment).
+	std::size_t thread_number();
+
+	/// \brief Set the name of the calling thread for the log header
+	void set_thread_name(std::string name);
+
+	/// \brief Get the name of a thread number, empty if it has none
+	std::string thread_name(std::size_t number);
+
+	/// \brief Get all thread names by thread number
+	std::map< std::size_t, std::string > thread_names();
+
+
+	//=============================================================================
+	// Implementation
+	//=============================================================================
+
+	namespace impl{ namespace thread_number{
+
+
+		struct name_registry{
+			std::mutex mutex;
+			std::map< std::size_t, std::string > names;
+		};
+
+		inline name_registry& registry(){
+			static name_registry value;
+			return value;
+		}
+
+
+	} }
+
+
+	inline std::size_t thread_number(){
+		static std::atomic< std::size_t > counter(0);
+		thread_local std::size_t const number = counter.fetch_add(1, std::memory_order_relaxed);
+		return number;
+	}
+
+	inline void set_thread_name(std::string name){
+		auto const number = thread_number();
+
+		auto& registry = impl::thread_number::registry();
+		std::lock_guard< std::mutex > lock(registry.mutex);
+		registry.names[number] = std::move(name);
+	}
+
+	inline std::string thread_name(std::size_t number){
+		auto& registry = impl::thread_number::registry();
+		std::lock_guard< std::mutex > lock(registry.mutex);
+
+		auto iter = registry.names.find(number);
+		return iter == registry.names.end() ? std::string() : iter->second;
+	}
+
+	inline std::map< std::size_t, std::string > thread_names(){
+		auto& registry = impl::thread_number::registry();
+		std::lock_guard< std::mutex > lock(registry.mutex);
+		return registry.names;
+	}
+
+
+}
+
+
+#endif
@@ -11,7 +11,7 @@ namespace tools{
 	struct timed_hierarchic_log: timed_log_base, hierarchic_log_base, log_base{
 		using hierarchic_log_base::first;
 
-		void prefix(std::ostringstream& os)const{
+		void prefix(std::ostream& os)const{
 			timed_log_base::extended_prefix(log_base::has_body, os);
 			hierarchic_log_base::prefix(os);
 		}
@@ -22,7 +22,7 @@ namespace tools{
 	struct timed_log_base{
 		timed_log_base(): start(std::chrono::system_clock::now()){}
 
-		void extended_prefix(bool has_body, std::ostringstream& os)const{
+		void extended_prefix(bool has_body, std::ostream& os)const{
 			auto end = std::chrono::system_clock::now();
 
 			time_to_string(os, start);
@@ -38,7 +38,7 @@ namespace tools{
 	};
 
 	struct timed_log: timed_log_base, log_base{
-		void prefix(std::ostringstream& os)const{
+		void prefix(std::ostream& os)const{
 			extended_prefix(log_base::has_body, os);
 		}
 	};
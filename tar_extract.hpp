@@ -0,0 +1 @@
+container_formats/tar_extract.hpp
\ No newline at end of file
@@ -0,0 +1 @@
+log/thread_number.hpp
\ No newline at end of file